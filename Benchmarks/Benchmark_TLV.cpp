@@ -0,0 +1,131 @@
+#include "PerfCounters.h"
+
+#include <TLV/TLVObject.h>
+#include <JsonToTLV/JsonToTlvConverter.h>
+#include <JsonToTLV/Utils.h>
+
+#include <stdlib.h>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+/*  Benchmarks of the TLV encoding operations and of the JSON line conversion with the hardware counters (see PerfCounters).
+ *
+ *  Benchmark_TLV [records]
+ *
+ *  Each case encodes 'records' records (the TLVObject is cleared and reused, so it's the encoding which is measured - not the
+ *  allocations) and reports per record: time, encoded size and the counters normalized per byte or per record.
+ *_____________________________________________________________________________________________________________________________*/
+namespace
+{
+
+#ifdef _WIN32
+const char* const s_nullFile = "NUL";
+#else
+const char* const s_nullFile = "/dev/null";
+#endif
+
+struct Case
+{
+    const char*                 name;
+    std::function<size_t()>     encode;     // Encodes one record, returns its size
+};
+
+/*  Prints the counter per byte/record or 'n/a' */
+void PrintValue(const PerfCounters& counters, PerfCounters::Counter counter, double divider)
+{
+    std::cout << std::setw(14);
+    if (counters.Available(counter)) {
+        std::cout << counters.Value(counter) / divider;
+    }
+    else {
+        std::cout << "n/a";
+    }
+}
+
+void Run(const Case& benchmark, size_t records, PerfCounters& counters)
+{
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < records / 10 + 1; ++i) {
+        benchmark.encode();                             // Warm up the caches and buffers
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    counters.Start();
+    for (size_t i = 0; i < records; ++i) {
+        bytes += benchmark.encode();
+    }
+    counters.Stop();
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << std::left << std::setw(28) << benchmark.name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(12) << ns / records << std::setw(12) << static_cast<double>(bytes) / records;
+    PrintValue(counters, PerfCounters::Cycles, static_cast<double>(bytes));
+    PrintValue(counters, PerfCounters::Instructions, static_cast<double>(bytes));
+    PrintValue(counters, PerfCounters::BranchMisses, static_cast<double>(records));
+    PrintValue(counters, PerfCounters::L1dMisses, static_cast<double>(records));
+    PrintValue(counters, PerfCounters::LlcMisses, static_cast<double>(records));
+    std::cout << std::endl;
+}
+
+}   // namespace
+
+
+int main(int argc, char** argv)
+{
+    size_t records = argc > 1 ? strtoull(argv[1], nullptr, 10) : 200000;
+    if (records == 0) {
+        std::cout << "Usage: Benchmark_TLV [records]" << std::endl;
+        return -1;
+    }
+
+    TLVObject tlv;
+    JsonToTlvConverter converter;
+    const std::string line = R"({"id":123456789,"name":"benchmark record","active":true,"score":-42,"tags":"a,b,c",)"
+                             R"("created":1650000000,"ratio":250,"comment":"plain ASCII string of a moderate length"})";
+    const std::string short16(16, 's'), medium200(200, 'm'), long1000(1000, 'l'), huge70000(70000, 'h');
+    std::vector<uint32_t> values(256);
+    for (size_t i = 0; i < values.size(); ++i) {
+        values[i] = static_cast<uint32_t>(i * 2654435761u);
+    }
+
+    converter.Convert(line);
+    const size_t lineRecordSize = converter.Record().Size();   // ConvertToTLV() has its own converter - same line, same size
+
+    auto record = [&tlv](const std::function<void()>& fill)
+    {
+        tlv.Clear();
+        fill();
+        return tlv.Size();
+    };
+    const std::vector<Case> cases = {
+        { "WriteInteger x64", [&] { return record([&] {
+            for (int i = 0; i < 8; ++i) {
+                tlv.WriteInteger(static_cast<int8_t>(i));   tlv.WriteInteger(static_cast<uint8_t>(i));
+                tlv.WriteInteger(static_cast<int16_t>(i));  tlv.WriteInteger(static_cast<uint16_t>(i));
+                tlv.WriteInteger(static_cast<int32_t>(i));  tlv.WriteInteger(static_cast<uint32_t>(i));
+                tlv.WriteInteger(static_cast<int64_t>(i));  tlv.WriteInteger(static_cast<uint64_t>(i));
+            } }); } },
+        { "WriteBool x64", [&] { return record([&] { for (int i = 0; i < 64; ++i) tlv.WriteBool(i & 1); }); } },
+        { "WriteString 16B x16", [&] { return record([&] { for (int i = 0; i < 16; ++i) tlv.WriteString(short16); }); } },
+        { "WriteString 200B x4 (0x81)", [&] { return record([&] { for (int i = 0; i < 4; ++i) tlv.WriteString(medium200); }); } },
+        { "WriteString 1000B x2 (0x82)", [&] { return record([&] { for (int i = 0; i < 2; ++i) tlv.WriteString(long1000); }); } },
+        { "WriteString 70000B (0x83)", [&] { return record([&] { tlv.WriteString(huge70000); }); } },
+        { "WriteIntegers u32 x256", [&] { return record([&] { tlv.WriteIntegers(values.data(), values.size()); }); } },
+        { "Convert (in memory)", [&] { converter.Convert(line); return converter.Record().Size(); } },
+        { "ConvertToTLV (null files)", [&] { ConvertToTLV(line, s_nullFile, s_nullFile); return lineRecordSize; } },
+    };
+
+    PerfCounters counters;
+    std::cout << std::left << std::setw(28) << "case" << std::right << std::setw(12) << "ns/rec" << std::setw(12) << "bytes/rec";
+    std::cout << std::setw(14) << "cycles/B" << std::setw(14) << "instr/B" << std::setw(14) << "br-miss/rec"
+              << std::setw(14) << "L1d-miss/rec" << std::setw(14) << "LLC-miss/rec" << std::endl;
+    for (const Case& benchmark : cases) {
+        Run(benchmark, records, counters);
+    }
+    return 0;
+}
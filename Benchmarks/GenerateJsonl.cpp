@@ -0,0 +1,117 @@
+#include "JsonlGenerator.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+
+/*  Writes the synthetic JSON lines (see JsonlGenerator) to the file or stdout:
+ *
+ *  GenerateJsonl [--lines N] [--keys K] [--key-cardinality C] [--mix class:weight,...] [--repeat RATE] [--seed S] [-o FILE]
+ *
+ *  Classes of the mix: bool, u8, u16, u32, u64, s8, s16, s32, s64, str7f, str81, str82, str83. The classes not listed keep
+ *  their default weights; 'class:0' turns the class off.
+ *_____________________________________________________________________________________________________________________________*/
+namespace
+{
+
+void PrintUsage()
+{
+    std::cout << "Usage: GenerateJsonl [--lines N] [--keys K] [--key-cardinality C] [--mix class:weight,...]"
+                 " [--repeat RATE] [--seed S] [-o FILE]" << std::endl;
+}
+
+bool ParseNumber(const char* str, uint64_t& value)
+{
+    char* end = nullptr;
+    value = strtoull(str, &end, 10);
+    return *str >= '0' && *str <= '9' && *end == '\0';
+}
+
+bool ParseMix(const std::string& mix, JsonlGenerator::Settings& settings)
+{
+    std::istringstream items(mix);
+    std::string item;
+    while (std::getline(items, item, ','))
+    {
+        size_t colon = item.find(':');
+        uint64_t weight;
+        if (colon == std::string::npos || !ParseNumber(item.c_str() + colon + 1, weight) || weight > UINT32_MAX) {
+            return false;
+        }
+        JsonlGenerator::ValueClass valueClass = JsonlGenerator::ClassByName(item.substr(0, colon));
+        if (valueClass == JsonlGenerator::ClassCount) {
+            return false;
+        }
+        settings.mix[valueClass] = static_cast<uint32_t>(weight);
+    }
+    return true;
+}
+
+}   // namespace
+
+
+int main(int argc, char** argv)
+{
+    JsonlGenerator::Settings settings;
+    uint64_t lines = 1000;
+    std::string outputFile;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* option = argv[i];
+        const char* value = i + 1 < argc ? argv[++i] : nullptr;
+        uint64_t number = 0;
+        bool ok = value != nullptr;
+
+        if      (ok && strcmp(option, "--lines") == 0)              ok = ParseNumber(value, lines);
+        else if (ok && strcmp(option, "--keys") == 0)
+        {
+            ok = ParseNumber(value, number) && number > 0;
+            settings.keysPerObject = static_cast<size_t>(number);
+        }
+        else if (ok && strcmp(option, "--key-cardinality") == 0)
+        {
+            ok = ParseNumber(value, number);
+            settings.keyCardinality = static_cast<size_t>(number);
+        }
+        else if (ok && strcmp(option, "--mix") == 0)                ok = ParseMix(value, settings);
+        else if (ok && strcmp(option, "--seed") == 0)               ok = ParseNumber(value, settings.seed);
+        else if (ok && strcmp(option, "-o") == 0)                   outputFile = value;
+        else if (ok && strcmp(option, "--repeat") == 0)
+        {
+            char* end = nullptr;
+            settings.repeatRate = strtod(value, &end);
+            ok = *end == '\0' && settings.repeatRate >= 0 && settings.repeatRate <= 1;
+        }
+        else {
+            ok = false;
+        }
+        if (!ok)
+        {
+            std::cout << "Wrong option: " << option << std::endl;
+            PrintUsage();
+            return -1;
+        }
+    }
+
+    std::ofstream file;
+    if (!outputFile.empty())
+    {
+        file.open(outputFile, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cout << "Unable to open the output file: " << outputFile << std::endl;
+            return -1;
+        }
+    }
+    std::ostream& out = outputFile.empty() ? std::cout : file;
+
+    JsonlGenerator generator(settings);
+    for (uint64_t i = 0; i < lines; ++i) {
+        out << generator.Next() << '\n';
+    }
+    out.flush();
+    return out.fail() ? -1 : 0;
+}
@@ -0,0 +1,153 @@
+#include "JsonlGenerator.h"
+
+#include <algorithm>
+#include <string.h>
+
+
+const size_t JsonlGenerator::s_repeatWindow = 1024;
+
+namespace
+{
+
+const char* const s_classNames[JsonlGenerator::ClassCount] = { "bool", "u8", "u16", "u32", "u64", "s8", "s16", "s32", "s64",
+                                                               "str7f", "str81", "str82", "str83" };
+
+const uint64_t s_maxStr83 = 0x20000 - 1;        // Longest string of the str83 class
+
+}   // namespace
+
+
+JsonlGenerator::JsonlGenerator(const Settings& settings)
+    : m_settings(settings)
+    , m_state(settings.seed)
+{
+    m_settings.keysPerObject = std::max<size_t>(1, m_settings.keysPerObject);
+    m_settings.keyCardinality = std::max(m_settings.keysPerObject, m_settings.keyCardinality);
+    for (uint32_t weight : m_settings.mix) {
+        m_mixTotal += weight;
+    }
+    if (m_mixTotal == 0)
+    {
+        m_settings.mix[Bool] = 1;
+        m_mixTotal = 1;
+    }
+}
+
+/*  Generates the next line (without '\n') */
+const std::string& JsonlGenerator::Next()
+{
+    ++m_lines;
+    // Uniform double in [0, 1) of the top 53 bits - so the rate 1 repeats every line and 0 none of them
+    if (!m_recent.empty() && static_cast<double>(Random() >> 11) * 0x1.0p-53 < m_settings.repeatRate) {
+        return m_recent[Random(0, m_recent.size() - 1)];
+    }
+
+    // Distinct keys: partial Fisher-Yates over the key pool (which is small - the key cardinality)
+    m_keys.resize(m_settings.keyCardinality);
+    for (size_t i = 0; i < m_keys.size(); ++i) {
+        m_keys[i] = i;
+    }
+    for (size_t i = 0; i < m_settings.keysPerObject; ++i) {
+        std::swap(m_keys[i], m_keys[Random(i, m_keys.size() - 1)]);
+    }
+
+    m_line = "{";
+    for (size_t i = 0; i < m_settings.keysPerObject; ++i)
+    {
+        if (i) {
+            m_line += ',';
+        }
+        m_line += "\"k";
+        m_line += std::to_string(m_keys[i]);
+        m_line += "\":";
+        AppendValue(PickClass());
+    }
+    m_line += '}';
+
+    if (m_recent.size() < s_repeatWindow) {
+        m_recent.push_back(m_line);
+    }
+    else {
+        m_recent[m_lines % s_repeatWindow] = m_line;
+    }
+    return m_line;
+}
+
+/*  Gets the value class by its name. Returns ClassCount if there is no such class */
+JsonlGenerator::ValueClass JsonlGenerator::ClassByName(const std::string& name)
+{
+    for (size_t i = 0; i < ClassCount; ++i)
+    {
+        if (name == s_classNames[i]) {
+            return static_cast<ValueClass>(i);
+        }
+    }
+    return ClassCount;
+}
+
+/*  Gets the name of the value class */
+const char* JsonlGenerator::ClassName(ValueClass valueClass)
+{
+    return s_classNames[valueClass];
+}
+
+/*  Next pseudo-random number (splitmix64) */
+uint64_t JsonlGenerator::Random()
+{
+    uint64_t z = (m_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/*  Uniform number in [from, to] (the modulo bias is negligible for the ranges here) */
+uint64_t JsonlGenerator::Random(uint64_t from, uint64_t to)
+{
+    uint64_t span = to - from + 1;
+    return span ? from + Random() % span : Random();       // Zero span - the whole 64-bit range
+}
+
+JsonlGenerator::ValueClass JsonlGenerator::PickClass()
+{
+    uint64_t pick = Random(0, m_mixTotal - 1);
+    for (size_t i = 0; i < ClassCount; ++i)
+    {
+        if (pick < m_settings.mix[i]) {
+            return static_cast<ValueClass>(i);
+        }
+        pick -= m_settings.mix[i];
+    }
+    return Bool;
+}
+
+void JsonlGenerator::AppendValue(ValueClass valueClass)
+{
+    uint64_t length = 0;
+    switch (valueClass) {
+        case Bool:  m_line += Random() & 1 ? "true" : "false";                                     return;
+        case U8:    m_line += std::to_string(Random(0, UINT8_MAX));                                 return;
+        case U16:   m_line += std::to_string(Random(UINT8_MAX + 1, UINT16_MAX));                    return;
+        case U32:   m_line += std::to_string(Random(UINT16_MAX + 1, UINT32_MAX));                   return;
+        case U64:   m_line += std::to_string(Random(UINT32_MAX + 1ULL, UINT64_MAX));                return;
+        case S8:    m_line += std::to_string(-static_cast<int64_t>(Random(1, 0x80)));               return;
+        case S16:   m_line += std::to_string(-static_cast<int64_t>(Random(0x81, 0x8000)));          return;
+        case S32:   m_line += std::to_string(-static_cast<int64_t>(Random(0x8001, 0x80000000)));    return;
+        case S64:   m_line += std::to_string(static_cast<int64_t>(0 - Random(0x80000001, 1ULL << 63))); return;
+        case Str7F: length = Random(0, 0x7F);               break;
+        case Str81: length = Random(0x80, 0xFF);            break;
+        case Str82: length = Random(0x100, 0xFFFF);         break;
+        case Str83: length = Random(0x10000, s_maxStr83);   break;
+        default:    return;
+    }
+    m_line += '"';
+    size_t pos = m_line.size();
+    m_line.resize(pos + length);
+    for (uint64_t i = 0; i < length; i += 8)
+    {
+        uint64_t bits = Random();
+        for (uint64_t j = i; j < std::min(length, i + 8); ++j, bits >>= 8) {
+            m_line[pos + j] = static_cast<char>('a' + (bits & 0xFF) % 26);
+        }
+    }
+    m_line += '"';
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+/*  Seeded generator of the synthetic JSON lines for reproducible benchmarks: the same settings and seed give the same lines on
+ *  any platform (own PRNG - the std distributions differ between the standard libraries).
+ *
+ *  Every line is a flat object of 'keysPerObject' distinct keys taken from the pool of 'keyCardinality' names ("k0", "k1"...).
+ *  The value of each key is of the class picked by the weights of the mix. The classes match what the converter writes:
+ *  integer classes give the values narrowed to the Tag of that width (u8 - [0, 0xFF], s16 - [-0x8000, -0x81]...), string
+ *  classes give the lengths of the TLV Length forms (str7f - up to 0x7F, str81 - 0x80...0xFF, str82 - up to 0xFFFF, str83 -
+ *  from 0x10000). With 'repeatRate' probability the line is a copy of one of the recent lines instead.
+ */
+class JsonlGenerator
+{
+public:
+    enum ValueClass { Bool, U8, U16, U32, U64, S8, S16, S32, S64, Str7F, Str81, Str82, Str83, ClassCount };
+
+    struct Settings
+    {
+        size_t   keysPerObject = 8;
+        size_t   keyCardinality = 64;
+        double   repeatRate = 0;
+        uint64_t seed = 1;
+        uint32_t mix[ClassCount] = { 2, 2, 1, 1, 1, 1, 1, 1, 1, 4, 1, 0, 0 };  // Weights of the value classes
+    };
+
+    static const size_t s_repeatWindow;
+
+public:
+    explicit JsonlGenerator(const Settings& settings);
+
+    /*  Generates the next line (without '\n') */
+    const std::string& Next();
+
+    /*  Gets the value class by its name ("bool", "u8"... "str83"). Returns ClassCount if there is no such class */
+    static ValueClass ClassByName(const std::string& name);
+
+    /*  Gets the name of the value class */
+    static const char* ClassName(ValueClass valueClass);
+
+private:
+    /*  Next pseudo-random number (splitmix64) */
+    uint64_t Random();
+
+    /*  Uniform number in [from, to] */
+    uint64_t Random(uint64_t from, uint64_t to);
+
+    ValueClass PickClass();
+
+    void AppendValue(ValueClass valueClass);
+
+    Settings                 m_settings;
+    uint64_t                 m_state;
+    uint64_t                 m_mixTotal = 0;
+    std::vector<std::string> m_recent;          // Ring of the recent lines to repeat
+    size_t                   m_lines = 0;
+    std::vector<size_t>      m_keys;            // Key indexes of the line being generated
+    std::string              m_line;
+};
@@ -0,0 +1,109 @@
+#include "PerfCounters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+namespace
+{
+
+const char* const s_names[PerfCounters::CounterCount] = { "cycles", "instructions", "branch-misses", "L1d-misses", "LLC-misses" };
+
+#ifdef __linux__
+
+int OpenCounter(uint32_t type, uint64_t config)
+{
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));     // This thread, any CPU
+}
+
+#endif
+
+}   // namespace
+
+
+PerfCounters::PerfCounters()
+{
+#ifdef __linux__
+    const uint64_t l1dReadMiss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    m_fds[Cycles] = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    m_fds[Instructions] = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    m_fds[BranchMisses] = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    m_fds[L1dMisses] = OpenCounter(PERF_TYPE_HW_CACHE, l1dReadMiss);
+    m_fds[LlcMisses] = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+#else
+    for (int& fd : m_fds) {
+        fd = -1;
+    }
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+    for (int fd : m_fds)
+    {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+#endif
+}
+
+/*  Resets and starts the counters */
+void PerfCounters::Start()
+{
+#ifdef __linux__
+    for (int fd : m_fds)
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+/*  Stops the counters and reads their values, scaled by enabled/running time if they were multiplexed */
+void PerfCounters::Stop()
+{
+#ifdef __linux__
+    for (int fd : m_fds)
+    {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    for (size_t i = 0; i < CounterCount; ++i)
+    {
+        uint64_t data[3] = {};                          // value, time enabled, time running
+        m_values[i] = 0;
+        if (m_fds[i] < 0 || read(m_fds[i], data, sizeof(data)) != sizeof(data)) {
+            continue;
+        }
+        m_values[i] = (data[2] && data[2] < data[1]) ? static_cast<uint64_t>(static_cast<double>(data[0]) * data[1] / data[2])
+                                                     : data[0];
+    }
+#endif
+}
+
+/*  Gets the name of the counter for the reports */
+const char* PerfCounters::Name(Counter counter)
+{
+    return s_names[counter];
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*  Hardware counters of the calling thread (perf_event_open, Linux) for the code between Start() and Stop(). User space only -
+ *  so it works with the default perf_event_paranoid. Counters the CPU, kernel or VM doesn't give are reported unavailable, the
+ *  rest still work; on the other platforms none is available. Values are scaled if the kernel had to multiplex the counters.
+ */
+class PerfCounters
+{
+public:
+    enum Counter { Cycles, Instructions, BranchMisses, L1dMisses, LlcMisses, CounterCount };
+
+public:
+    PerfCounters();
+
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    /*  Resets and starts the counters */
+    void Start();
+
+    /*  Stops the counters and reads their values */
+    void Stop();
+
+    /*  Checks whether the counter is working */
+    bool Available(Counter counter) const       { return m_fds[counter] >= 0; }
+
+    /*  Gets the value of the counter for the last Start()/Stop() */
+    uint64_t Value(Counter counter) const       { return m_values[counter]; }
+
+    /*  Gets the name of the counter for the reports */
+    static const char* Name(Counter counter);
+
+private:
+    int      m_fds[CounterCount];
+    uint64_t m_values[CounterCount] = {};
+};
@@ -0,0 +1,113 @@
+#include "Arena.h"
+
+#include <stdlib.h>
+#include <new>
+
+
+const size_t Arena::s_defaultBlockSize = 64 * 1024;
+
+thread_local Arena* Arena::s_current = nullptr;
+
+Arena::Scope::Scope(Arena& arena)
+    : m_arena(arena)
+    , m_previous(s_current)
+{
+    s_current = &arena;
+}
+
+Arena::Scope::~Scope()
+{
+    s_current = m_previous;
+    m_arena.Reset();
+}
+
+Arena::Arena(size_t blockSize)
+    : m_blockSize(blockSize)
+{}
+
+Arena::~Arena()
+{
+    for (const Block& block : m_blocks) {
+        free(block.data);
+    }
+    for (const Block& block : m_oversized) {
+        free(block.data);
+    }
+}
+
+/*  Allocates 'size' bytes aligned to 'alignment'. The fast path is just a pointer bump inside the current block */
+void* Arena::Allocate(size_t size, size_t alignment)
+{
+    uintptr_t ptr = reinterpret_cast<uintptr_t>(m_ptr);
+    uintptr_t aligned = (ptr + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+
+    if (m_ptr && aligned + size <= reinterpret_cast<uintptr_t>(m_end))
+    {
+        m_ptr = reinterpret_cast<uint8_t*>(aligned + size);
+        m_used += size;
+        return reinterpret_cast<void*>(aligned);
+    }
+    return AllocateSlow(size, alignment);
+}
+
+/*  Moves to the next regular block (allocating it if necessary), or gives a dedicated block to the request bigger than a half
+ *  of the regular one - otherwise the rest of the current block would be wasted */
+void* Arena::AllocateSlow(size_t size, size_t alignment)
+{
+    // malloc() memory is aligned for any standard type, so the block start fits any supported 'alignment'
+    if (size > m_blockSize / 2)
+    {
+        uint8_t* data = static_cast<uint8_t*>(malloc(size));
+        if (!data) {
+            throw std::bad_alloc();
+        }
+        m_oversized.push_back({ data, size });
+        m_used += size;
+        m_capacity += size;
+        return data;
+    }
+
+    size_t next = m_ptr ? m_current + 1 : 0;
+    if (next == m_blocks.size())
+    {
+        uint8_t* data = static_cast<uint8_t*>(malloc(m_blockSize));
+        if (!data) {
+            throw std::bad_alloc();
+        }
+        m_blocks.push_back({ data, m_blockSize });
+        m_capacity += m_blockSize;
+    }
+    m_current = next;
+    m_ptr = m_blocks[m_current].data;
+    m_end = m_ptr + m_blocks[m_current].size;
+    return Allocate(size, alignment);
+}
+
+/*  Rewinds the arena. Regular blocks are kept for reuse, the oversized ones are freed */
+void Arena::Reset()
+{
+    for (const Block& block : m_oversized)
+    {
+        free(block.data);
+        m_capacity -= block.size;
+    }
+    m_oversized.clear();
+
+    m_current = 0;
+    m_ptr = m_blocks.empty() ? nullptr : m_blocks.front().data;
+    m_end = m_blocks.empty() ? nullptr : m_ptr + m_blocks.front().size;
+    m_used = 0;
+}
+
+/*  Gets the arena of the innermost Scope, or the thread's own arena if there is no Scope */
+Arena& Arena::Current()
+{
+    return s_current ? *s_current : ThreadLocal();
+}
+
+/*  Gets the thread's own arena */
+Arena& Arena::ThreadLocal()
+{
+    static thread_local Arena arena;
+    return arena;
+}
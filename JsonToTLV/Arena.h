@@ -0,0 +1,122 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*  Monotonic arena for the short-lived temporaries of one JSON line conversion (JSON DOM nodes, keys, dictionary nodes...).
+ *  Allocation is a pointer bump inside the current block,  deallocation is a no-op - the whole memory is released at once by
+ *  Reset(), which rewinds the arena and keeps its blocks for the next line. So in the steady state a line costs no malloc/free.
+ *
+ *  Memory is taken from blocks of 'blockSize' bytes. Requests bigger than the block get a dedicated block, which is returned
+ *  to the system on Reset() - so one pathological line doesn't pin a huge amount of memory for the rest of the run.
+ *
+ *  Arena is not thread-safe: each thread is supposed to use its own one (see Arena::ThreadLocal()).
+ */
+class Arena
+{
+public:
+    static const size_t s_defaultBlockSize;
+
+    /*  RAII guard making the 'arena' current for the ArenaAllocator's of this thread. On destruction it resets the arena (all the
+     *  memory allocated inside the scope becomes invalid!) and restores the previously current arena */
+    class Scope
+    {
+    public:
+        explicit Scope(Arena& arena);
+
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Arena& m_arena;
+        Arena* m_previous;
+    };
+
+public:
+    explicit Arena(size_t blockSize = s_defaultBlockSize);
+
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+
+    Arena& operator=(const Arena&) = delete;
+
+    /*  Allocates 'size' bytes aligned to 'alignment' (power of 2, not bigger than alignof(max_align_t)) */
+    void* Allocate(size_t size, size_t alignment);
+
+    /*  Rewinds the arena. Regular blocks are kept for reuse, the oversized ones are freed */
+    void Reset();
+
+    /*  Gets the amount of bytes handed out since the last Reset() */
+    size_t Used() const         { return m_used; }
+
+    /*  Gets the amount of memory held by the arena */
+    size_t Capacity() const     { return m_capacity; }
+
+    /*  Gets the arena ArenaAllocator's of the calling thread are allocating from: the one of the innermost Scope, or the thread's
+     *  own arena if there is no Scope */
+    static Arena& Current();
+
+    /*  Gets the thread's own arena */
+    static Arena& ThreadLocal();
+
+private:
+    struct Block
+    {
+        uint8_t* data;
+        size_t   size;
+    };
+
+    void* AllocateSlow(size_t size, size_t alignment);
+
+    std::vector<Block> m_blocks;        // Regular blocks, [0 ... m_current] are in use
+    std::vector<Block> m_oversized;     // Dedicated blocks for the big requests
+    size_t   m_blockSize;
+    size_t   m_current = 0;
+    uint8_t* m_ptr = nullptr;
+    uint8_t* m_end = nullptr;
+    size_t   m_used = 0;
+    size_t   m_capacity = 0;
+
+    static thread_local Arena* s_current;
+};
+
+
+/*  Stateless STL allocator over the Arena::Current() of the calling thread. Being stateless it fits the containers which only
+ *  accept the allocator type (like the nlohmann::basic_json's AllocatorType). Containers using it must not outlive the Scope
+ *  they were filled in */
+template<class T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+
+    template<class U>
+    struct rebind { using other = ArenaAllocator<U>; };
+
+    ArenaAllocator() = default;
+
+    template<class U>
+    ArenaAllocator(const ArenaAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n)
+    {
+        return static_cast<T*>(Arena::Current().Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) noexcept {}     // Memory goes back with the Arena::Reset()
+};
+
+template<class T, class U>
+bool operator==(const ArenaAllocator<T>&, const ArenaAllocator<U>&) { return true; }
+
+template<class T, class U>
+bool operator!=(const ArenaAllocator<T>&, const ArenaAllocator<U>&) { return false; }
+
+
+using ArenaString = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
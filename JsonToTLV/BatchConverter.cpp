@@ -0,0 +1,544 @@
+#include "BatchConverter.h"
+#include "Trace.h"
+
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+
+
+const size_t BatchConverter::s_defaultRangeSize = 8 * 1024 * 1024;
+const size_t BatchConverter::s_maxBufferedRanges = 2;
+const char* const BatchConverter::s_manifestName = "manifest";
+
+namespace
+{
+
+const size_t s_splitBlockSize = 1024 * 1024;
+
+size_t ThreadCount(size_t requested)
+{
+    if (requested) {
+        return requested;
+    }
+    size_t hardware = std::thread::hardware_concurrency();
+    return hardware ? hardware : 1;
+}
+
+}   // namespace
+
+
+BatchConverter::BatchConverter(const Options& options, size_t rangeSize)
+    : m_options(options)
+    , m_rangeSize(rangeSize ? rangeSize : 1)
+    , m_pool(ThreadCount(options.threads))
+{
+    for (size_t i = 0; i < m_pool.Threads(); ++i)
+    {
+        m_workers.emplace_back(new Worker);
+        Worker& worker = *m_workers.back();
+        worker.writer = OutputWriter::Create(options.ioUring);
+        worker.converter.SetFlushThreshold(options.flushThreshold);
+        worker.converter.SetDictFormat(options.dictFormat);
+        worker.converter.SetOutputWriter(worker.writer.get());
+        if (options.stats) {
+            worker.converter.SetStats(&worker.stats);
+        }
+    }
+}
+
+/*  Converts all the inputs. Returns false if any input or line has failed */
+bool BatchConverter::Run()
+{
+    auto start = std::chrono::steady_clock::now();
+    if (!CollectInputs() || !BuildKeySet() || !OpenDictionaryStores() || !OpenSegments()) {
+        return false;
+    }
+    if (!m_options.rejectsFile.empty())
+    {
+        m_rejects.open(m_options.rejectsFile, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!m_rejects.is_open()) {
+            std::cout << "Unable to open the rejects file: " << m_options.rejectsFile << std::endl;
+            return false;
+        }
+    }
+
+    // Ascending size - so the back of every worker's deque, which it starts from, has its biggest file
+    std::vector<size_t> order(m_inputs.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) { return m_inputs[a].size < m_inputs[b].size; });
+
+    for (size_t input : order)
+    {
+        if (m_inputs[input].size > m_rangeSize) {
+            m_pool.Push([this, input](size_t worker) { Split(worker, input); });
+        }
+        else {
+            uint64_t size = m_inputs[input].size;
+            m_pool.Push([this, input, size](size_t worker) { ConvertRange(worker, input, 0, size, 0); });
+        }
+    }
+    m_pool.Run();
+
+    for (const auto& worker : m_workers)
+    {
+        ConversionStats::Timer timer(m_options.stats ? &worker->stats : nullptr, ConversionStats::Dump);
+        if (!worker->writer->Finish()) {
+            m_failed = true;
+        }
+    }
+    if (!CloseSegments()) {
+        m_failed = true;
+    }
+    for (const Input& input : m_inputs)
+    {
+        if (input.dictStore && !input.dictStore->Close()) {
+            m_failed = true;
+        }
+    }
+    if (m_rejects.is_open())
+    {
+        m_rejects.close();
+        m_failed = m_failed || m_rejects.fail();
+    }
+    m_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return !m_failed;
+}
+
+/*  Prints the statistics of the run: the merged counters, then the share of every thread */
+void BatchConverter::PrintStats(std::ostream& out) const
+{
+    ConversionStats total;
+    for (const auto& worker : m_workers) {
+        total.Merge(worker->stats);
+    }
+    total.Print(out, m_seconds);
+
+    out << "Threads:" << std::endl;
+    for (size_t i = 0; i < m_workers.size(); ++i)
+    {
+        const ConversionStats& stats = m_workers[i]->stats;
+        uint64_t busyNs = 0;
+        for (uint64_t ns : stats.phaseNs) {
+            busyNs += ns;
+        }
+        out << "  #" << i << "\tlines: " << stats.lines << "\trecords: " << stats.records << "\tbytes in: " << stats.bytesIn
+            << "\tbusy: " << busyNs / 1e9 << " s" << std::endl;
+    }
+}
+
+/*  Expands the directories, names the output directories of the inputs */
+bool BatchConverter::CollectInputs()
+{
+    std::vector<std::string> files;
+    bool ok = true;
+
+    for (const std::string& path : m_options.inputs)
+    {
+        std::error_code error;
+        if (!std::filesystem::is_directory(path, error)) {
+            files.push_back(path);
+            continue;
+        }
+        std::vector<std::string> entries;
+        for (const auto& entry : std::filesystem::directory_iterator(path, error))
+        {
+            if (entry.is_regular_file(error)) {
+                entries.push_back(entry.path().string());
+            }
+        }
+        if (error)
+        {
+            std::cout << "Unable to list the input directory: " << path << std::endl;
+            ok = false;
+        }
+        std::sort(entries.begin(), entries.end());
+        files.insert(files.end(), entries.begin(), entries.end());
+    }
+
+    // The only file goes to the output directory itself (as it always did), many of them - to the subdirectories by their names
+    bool single = files.size() == 1 && !std::filesystem::is_directory(m_options.inputs.front());
+    std::unordered_set<std::string> names;
+
+    for (const std::string& file : files)
+    {
+        std::error_code error;
+        Input input;
+        input.path = file;
+        input.size = std::filesystem::file_size(file, error);
+        if (error)
+        {
+            std::cout << "Unable to open the input file: " << file << std::endl;
+            ok = false;
+            continue;
+        }
+        if (!single)
+        {
+            std::string name = std::filesystem::path(file).filename().string();
+            std::string unique = name;
+            for (size_t k = 1; !names.insert(unique).second; ++k) {
+                unique = name + "_" + std::to_string(k);        // Same names from different directories
+            }
+            input.outputDir = (std::filesystem::path(m_options.outputDir) / unique).string();
+        }
+        else {
+            input.outputDir = m_options.outputDir;
+        }
+        m_inputs.push_back(std::move(input));
+    }
+    return ok;
+}
+
+/*  Opens the dictionary stores of the inputs' output directories (Options::dedupeDicts) */
+bool BatchConverter::OpenDictionaryStores()
+{
+    if (!m_options.dedupeDicts) {
+        return true;
+    }
+    for (Input& input : m_inputs)
+    {
+        input.dictStore.reset(new DictionaryStore(input.outputDir));
+        if (!input.dictStore->Open()) {
+            std::cout << "Unable to create the dictionary index in: " << input.outputDir << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/*  Creates the segment files of the workers (Options::segments) */
+bool BatchConverter::OpenSegments()
+{
+    if (!m_options.segments) {
+        return true;
+    }
+    std::error_code error;
+    if (!m_options.outputDir.empty()) {
+        std::filesystem::create_directories(m_options.outputDir, error);
+    }
+    for (size_t i = 0; i < m_workers.size(); ++i)
+    {
+        std::string name = "segment_" + std::to_string(i);
+        std::string path = m_options.outputDir.empty() ? name : (std::filesystem::path(m_options.outputDir) / name).string();
+        if (!m_workers[i]->segment.Open(path)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*  Closes the segments and writes the manifest of their chunks (Options::segments) */
+bool BatchConverter::CloseSegments()
+{
+    if (!m_options.segments) {
+        return true;
+    }
+    bool ok = true;
+    std::vector<std::pair<size_t, const Chunk*>> chunks;     // Worker, chunk
+    for (size_t i = 0; i < m_workers.size(); ++i)
+    {
+        ok = m_workers[i]->segment.Close() && ok;
+        for (const Chunk& chunk : m_workers[i]->chunks) {
+            chunks.emplace_back(i, &chunk);
+        }
+    }
+    std::sort(chunks.begin(), chunks.end(), [](const auto& a, const auto& b) {
+        return a.second->input != b.second->input ? a.second->input < b.second->input : a.second->firstLine < b.second->firstLine;
+    });
+
+    std::string path = m_options.outputDir.empty() ? s_manifestName
+                                                   : (std::filesystem::path(m_options.outputDir) / s_manifestName).string();
+    std::ofstream manifest(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!manifest.is_open()) {
+        std::cout << "Unable to create the manifest: " << path << std::endl;
+        return false;
+    }
+    for (const auto& [worker, chunk] : chunks)
+    {
+        manifest << m_inputs[chunk->input].path << '\t' << chunk->firstLine << '\t' << chunk->lines << "\tsegment_" << worker
+                 << '\t' << chunk->offset << '\t' << chunk->size << '\n';
+    }
+    manifest.close();
+    return ok && !manifest.fail();
+}
+
+/*  Builds the key set of Options::keysFile or Options::keysSample, if any */
+bool BatchConverter::BuildKeySet()
+{
+    std::vector<std::string> keys;
+    if (!m_options.keysFile.empty())
+    {
+        if (!KeySet::Load(m_options.keysFile, keys)) {
+            std::cout << "Unable to read the keys file: " << m_options.keysFile << std::endl;
+            return false;
+        }
+    }
+    else if (m_options.keysSample && !m_inputs.empty())
+    {
+        if (!KeySet::Sample(m_inputs.front().path, m_options.keysSample, keys)) {
+            std::cout << "Unable to sample the keys of: " << m_inputs.front().path << std::endl;
+            return false;
+        }
+    }
+    else {
+        return true;
+    }
+
+    if (!m_keySet.Build(keys)) {
+        std::cout << "Unable to build the key set: the keys repeat or there are more than " << KeySet::s_maxKeys << std::endl;
+        return false;
+    }
+    for (const auto& worker : m_workers) {
+        worker->converter.SetKeySet(&m_keySet);
+    }
+    return true;
+}
+
+/*  Reads the big input and pushes the tasks of its line-aligned ranges - with their bytes while not too many are waiting */
+void BatchConverter::Split(size_t worker, size_t input)
+{
+    Worker& state = *m_workers[worker];
+    ConversionStats::Timer timer(m_options.stats ? &state.stats : nullptr, ConversionStats::Read);
+    TRACE_SPAN("split");
+    std::ifstream file(m_inputs[input].path, std::ios::in | std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cout << "Unable to open the input file: " << m_inputs[input].path << std::endl;
+        m_failed = true;
+        return;
+    }
+
+    const size_t maxBuffered = s_maxBufferedRanges * m_pool.Threads();
+    std::vector<char> block(s_splitBlockSize);
+    auto range = std::make_shared<std::vector<char>>();     // Bytes of the current range read so far
+    uint64_t offset = 0;                                // Of the block in the file
+    uint64_t rangeBegin = 0;
+    uint64_t rangeFirstLine = 0;
+    uint64_t lines = 0;
+
+    // Pushes the range ending at 'rangeEnd' - its bytes are the 'range'
+    auto push = [&](uint64_t rangeEnd)
+    {
+        std::shared_ptr<std::vector<char>> data;
+        if (m_bufferedRanges.load(std::memory_order_relaxed) < maxBuffered)
+        {
+            ++m_bufferedRanges;
+            data = std::move(range);
+            range = std::make_shared<std::vector<char>>();
+            range->reserve(m_rangeSize);
+        }
+        else {
+            range->clear();
+        }
+        m_pool.Push([this, input, rangeBegin, rangeEnd, rangeFirstLine, data](size_t worker) {
+            ConvertRange(worker, input, rangeBegin, rangeEnd, rangeFirstLine, data);
+        });
+    };
+
+    while (file)
+    {
+        file.read(block.data(), block.size());
+        size_t got = static_cast<size_t>(file.gcount());
+        const char* p = block.data();
+        const char* end = p + got;
+        const char* copied = p;                         // Block bytes up to it are in the 'range'
+
+        while ((p = static_cast<const char*>(memchr(p, '\n', end - p))) != nullptr)
+        {
+            ++p;
+            ++lines;
+            uint64_t lineEnd = offset + (p - block.data());
+            if (lineEnd - rangeBegin >= m_rangeSize)
+            {
+                range->insert(range->end(), copied, p);
+                copied = p;
+                push(lineEnd);
+                rangeBegin = lineEnd;
+                rangeFirstLine = lines;
+            }
+        }
+        range->insert(range->end(), copied, end);
+        offset += got;
+    }
+    if (offset > rangeBegin) {
+        push(offset);
+    }
+}
+
+/*  Converts the lines in [begin, end) of the input, the first of them has the number 'firstLine' */
+void BatchConverter::ConvertRange(size_t worker, size_t input, uint64_t begin, uint64_t end, uint64_t firstLine,
+                                  std::shared_ptr<std::vector<char>> data)
+{
+    Worker& state = *m_workers[worker];
+    ConversionStats* stats = m_options.stats ? &state.stats : nullptr;
+    if (data)
+    {
+        state.buffer.swap(*data);
+        data.reset();
+        --m_bufferedRanges;
+    }
+    else
+    {
+        ConversionStats::Timer timer(stats, ConversionStats::Read);
+        TRACE_SPAN("read range");
+        std::ifstream file(m_inputs[input].path, std::ios::in | std::ios::binary);
+        if (!file.is_open())
+        {
+            std::cout << "Unable to open the input file: " << m_inputs[input].path << std::endl;
+            m_failed = true;
+            return;
+        }
+        state.buffer.resize(static_cast<size_t>(end - begin));
+        file.seekg(static_cast<std::streamoff>(begin));
+        file.read(state.buffer.data(), state.buffer.size());
+        state.buffer.resize(static_cast<size_t>(file.gcount()));
+    }
+    size_t got = state.buffer.size();
+
+    // Lines the same std::getline() gives: the last one may lack '\n', nothing follows the final '\n'
+    const char* p = state.buffer.data();
+    const char* last = p + got;
+    uint64_t number = firstLine;
+    if (m_options.segments)
+    {
+        state.lines.clear();
+        while (p < last)
+        {
+            const char* newline = static_cast<const char*>(memchr(p, '\n', last - p));
+            const char* lineEnd = newline ? newline : last;
+            if (stats)
+            {
+                ++stats->lines;
+                stats->bytesIn += (newline ? newline + 1 : last) - p;
+            }
+            state.lines.emplace_back(p, lineEnd - p);
+            p = newline ? newline + 1 : last;
+        }
+        if (!ConvertToSegment(state, input, state.lines.data(), state.lines.size(), firstLine)) {
+            m_failed = true;
+        }
+        return;
+    }
+    while (p < last)
+    {
+        const char* newline = static_cast<const char*>(memchr(p, '\n', last - p));
+        const char* lineEnd = newline ? newline : last;
+        if (stats)
+        {
+            ++stats->lines;
+            stats->bytesIn += (newline ? newline + 1 : last) - p;
+        }
+        std::string_view line(p, lineEnd - p);
+        if (!ConvertLine(state, input, line, number) && !Reject(state, input, line, number))
+        {
+            m_failed = true;
+            break;
+        }
+        ++number;
+        p = newline ? newline + 1 : last;
+    }
+}
+
+/*  Converts the 'count' lines of the range starting from the line 'firstLine' to a chunk of the worker's segment. The failed lines
+ *  are rejected and left empty in the chunk;  without the rejects file the chunk ends before the first of them */
+bool BatchConverter::ConvertToSegment(Worker& state, size_t input, const std::string_view* lines, size_t count, uint64_t firstLine)
+{
+    state.converter.ConvertBatch(lines, count, state.batch);
+
+    size_t written = count;
+    for (const auto& [line, error] : state.batch.errors)
+    {
+        state.error = error;
+        if (!Reject(state, input, lines[line], firstLine + line))
+        {
+            written = line;
+            break;
+        }
+    }
+
+    ConversionStats::Timer timer(m_options.stats ? &state.stats : nullptr, ConversionStats::Dump);
+    TRACE_SPAN("segment");
+    Chunk chunk { input, firstLine, written, 0, 0 };
+    if (written && !state.segment.Append(state.batch, written, chunk.offset, chunk.size))
+    {
+        std::cout << "Unable to write the segment file: " << state.segment.Path() << std::endl;
+        return false;
+    }
+    if (written) {
+        state.chunks.push_back(chunk);
+    }
+    return written == count;
+}
+
+/*  Converts one line to its files */
+bool BatchConverter::ConvertLine(Worker& state, size_t input, std::string_view line, uint64_t number)
+{
+    auto layout = state.layouts.find(input);
+    if (layout == state.layouts.end()) {
+        layout = state.layouts.emplace(input, OutputLayout(m_inputs[input].outputDir, m_options.shardLevels,
+                                                           m_options.sharding)).first;
+    }
+    DictionaryStore* store = m_inputs[input].dictStore.get();
+    std::string recordName = layout->second.Path("record", number);
+    std::string dictName = store ? std::string() : layout->second.Path("dict", number);
+    if (recordName.empty() || (!store && dictName.empty()))
+    {
+        state.error = "unable to create the output directory";
+        return false;
+    }
+    if (!state.converter.Convert(line, recordName, dictName))
+    {
+        state.error = state.converter.LastError();
+        return false;
+    }
+    if (!store) {
+        return true;
+    }
+
+    // The dictionary is written by the first line having it, the rest just reference it
+    ConversionStats::Timer timer(m_options.stats ? &state.stats : nullptr, ConversionStats::Dump);
+    size_t dictSize = state.converter.DictionarySize();
+    bool isNew;
+    if (!store->Reference(number, state.converter.DictionaryData(), dictSize, isNew))
+    {
+        state.error = "unable to write the dictionary or its index";
+        return false;
+    }
+    if (isNew && m_options.stats) {
+        state.stats.bytesOut += dictSize;
+    }
+    return true;
+}
+
+/*  Puts the failed line to the rejects file. Without it just tells what's wrong and returns false - the range stops */
+bool BatchConverter::Reject(Worker& state, size_t input, std::string_view line, uint64_t number)
+{
+    if (!m_rejects.is_open())
+    {
+        std::cout << "Line " << number << " of " << m_inputs[input].path << ": " << state.error << std::endl;
+        return false;
+    }
+    ++state.stats.rejected;
+
+    std::lock_guard<std::mutex> lock(m_rejectsMutex);        // Rejects are rare - the lock costs nothing
+    m_rejects << m_inputs[input].path << ':' << number << '\t' << state.error << '\t' << line << '\n';
+    return !m_rejects.fail();
+}
+
+/*  Gets the number of the lines put to the rejects file */
+uint64_t BatchConverter::Rejected() const
+{
+    uint64_t rejected = 0;
+    for (const auto& worker : m_workers) {
+        rejected += worker->stats.rejected;
+    }
+    return rejected;
+}
@@ -0,0 +1,143 @@
+#pragma once
+#include "ConversionStats.h"
+#include "DictionaryStore.h"
+#include "JsonToTlvConverter.h"
+#include "KeySet.h"
+#include "Options.h"
+#include "OutputLayout.h"
+#include "OutputWriter.h"
+#include "SegmentWriter.h"
+#include "WorkStealingPool.h"
+
+#include <stdint.h>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/*  Converts all the input files (directories are expanded to the regular files in them) on the WorkStealingPool. Every line
+ *  gives its record_N/dict_N as before, N being the line number inside its file. One input file writes right to the output
+ *  directory; with many of them each gets its own subdirectory named after the file.
+ *
+ *  A file bigger than the range size is split into line-aligned ranges:  the splitting task reads the file (counting the lines -
+ *  the ranges must know their first line number) and pushes a task per range as soon as it's found, so the idle workers steal
+ *  and convert the ranges while the rest is still being split. Thus one giant file doesn't leave the tail to one thread. The
+ *  range task takes the bytes the splitter has read, so the file is read once;  only when the workers fall behind and
+ *  s_maxBufferedRanges per thread are waiting, the next ranges are passed as offsets and read again by their tasks - the memory
+ *  stays bounded whatever the file size is.
+ *
+ *  A failed line stops its range (the lines before it in the range are converted), other ranges go on. With the rejects file
+ *  (Options::rejectsFile) the failed lines are put there as  'input:N<TAB>reason<TAB>line'  and the conversion goes on.
+ *
+ *  With Options::dedupeDicts the dictionaries go to the DictionaryStore of the input's output directory instead of dict_N.
+ *
+ *  With Options::segments there are no files per line: each worker appends the ranges it converts to its own 'segment_W' in the
+ *  output directory (see SegmentWriter), and the 'manifest' there tells for every range its input, first line, number of lines,
+ *  segment, offset and size - a  'input<TAB>firstLine<TAB>lines<TAB>segment_W<TAB>offset<TAB>size'  line each, sorted by input
+ *  and line. The workers never wait for each other to write, the global order is restored by the manifest only.
+ */
+class BatchConverter
+{
+public:
+    static const size_t      s_defaultRangeSize;
+    static const size_t      s_maxBufferedRanges;
+    static const char* const s_manifestName;
+
+public:
+    explicit BatchConverter(const Options& options, size_t rangeSize = s_defaultRangeSize);
+
+    BatchConverter(const BatchConverter&) = delete;
+
+    BatchConverter& operator=(const BatchConverter&) = delete;
+
+    /*  Converts all the inputs. Returns false if any input or line has failed */
+    bool Run();
+
+    /*  Gets the number of the lines put to the rejects file */
+    uint64_t Rejected() const;
+
+    /*  Prints the statistics of the run (the counters are collected with Options::stats only) */
+    void PrintStats(std::ostream& out) const;
+
+private:
+    struct Input
+    {
+        std::string path;
+        std::string outputDir;
+        uint64_t    size = 0;
+        std::unique_ptr<DictionaryStore> dictStore;     // Options::dedupeDicts only
+    };
+
+    /*  Range written to a segment (Options::segments) */
+    struct Chunk
+    {
+        size_t   input;
+        uint64_t firstLine;
+        uint64_t lines;
+        uint64_t offset;                    // In the segment
+        uint64_t size;
+    };
+
+    /*  Per-worker state - touched by its worker only */
+    struct Worker
+    {
+        ConversionStats                          stats;
+        JsonToTlvConverter                       converter;
+        std::unique_ptr<OutputWriter>            writer;
+        std::vector<char>                        buffer;
+        std::string                              error;     // What's wrong with the last failed line
+        std::unordered_map<size_t, OutputLayout> layouts;   // By the input index
+        SegmentWriter                            segment;   // Options::segments only
+        JsonToTlvConverter::Batch                batch;
+        std::vector<std::string_view>            lines;
+        std::vector<Chunk>                       chunks;
+    };
+
+    /*  Expands the directories, names the output directories of the inputs */
+    bool CollectInputs();
+
+    /*  Opens the dictionary stores of the inputs' output directories (Options::dedupeDicts) */
+    bool OpenDictionaryStores();
+
+    /*  Creates the segment files of the workers (Options::segments) */
+    bool OpenSegments();
+
+    /*  Closes the segments and writes the manifest of their chunks (Options::segments) */
+    bool CloseSegments();
+
+    /*  Builds the key set of Options::keysFile or Options::keysSample, if any */
+    bool BuildKeySet();
+
+    /*  Reads the big input and pushes the tasks of its line-aligned ranges */
+    void Split(size_t worker, size_t input);
+
+    /*  Converts the lines in [begin, end) of the input, the first of them has the number 'firstLine'. The range is read from the
+     *  file unless its bytes are given in the 'data' */
+    void ConvertRange(size_t worker, size_t input, uint64_t begin, uint64_t end, uint64_t firstLine,
+                      std::shared_ptr<std::vector<char>> data = nullptr);
+
+    /*  Converts the 'count' lines of the range starting from the line 'firstLine' to a chunk of the worker's segment */
+    bool ConvertToSegment(Worker& state, size_t input, const std::string_view* lines, size_t count, uint64_t firstLine);
+
+    /*  Converts one line to its files */
+    bool ConvertLine(Worker& state, size_t input, std::string_view line, uint64_t number);
+
+    /*  Puts the failed line to the rejects file. Without it just tells what's wrong and returns false */
+    bool Reject(Worker& state, size_t input, std::string_view line, uint64_t number);
+
+    const Options&                       m_options;
+    size_t                               m_rangeSize;
+    std::vector<Input>                   m_inputs;
+    KeySet                               m_keySet;
+    WorkStealingPool                     m_pool;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<bool>                    m_failed { false };
+    std::atomic<size_t>                  m_bufferedRanges { 0 };    // Read by Split() and waiting for their tasks
+    std::ofstream                        m_rejects;
+    std::mutex                           m_rejectsMutex;
+    double                               m_seconds = 0;     // Wall time of Run()
+};
@@ -0,0 +1,103 @@
+#include "ConversionStats.h"
+#include "TLVReader.h"
+
+#include <iomanip>
+
+
+namespace
+{
+
+const char* const s_phaseNames[ConversionStats::PhaseCount] = { "read/split", "parse", "encode", "dump" };
+
+const char* const s_tagNames[] = { "?", "Bool_T", "Bool_F", "Integer_S8", "Integer_S16", "Integer_S32", "Integer_S64",
+                                   "Integer_U8", "Integer_U16", "Integer_U32", "Integer_U64", "String" };
+
+size_t BitLength(uint64_t value)
+{
+    size_t bits = 0;
+    for (; value; value >>= 1) {
+        ++bits;
+    }
+    return bits;
+}
+
+}   // namespace
+
+
+/*  Counts the converted record (sizes and Tags) and its dictionary */
+void ConversionStats::AddRecord(const TLVObject& record, size_t recordSize, size_t dictSize)
+{
+    ++records;
+    bytesOut += recordSize + dictSize;
+    ++recordSizes[BitLength(recordSize)];
+
+    if (record.Size() != recordSize) {
+        return;                                     // Flushed already
+    }
+    TLVReader reader(record.Data(), record.Size());
+    while (!reader.AtEnd())
+    {
+        ++tags[static_cast<uint8_t>(reader.PeekTag())];
+        if (!reader.Skip()) {
+            break;
+        }
+    }
+}
+
+/*  Adds the counters of the other thread */
+void ConversionStats::Merge(const ConversionStats& other)
+{
+    for (size_t i = 0; i < PhaseCount; ++i) {
+        phaseNs[i] += other.phaseNs[i];
+    }
+    bytesIn += other.bytesIn;
+    bytesOut += other.bytesOut;
+    lines += other.lines;
+    records += other.records;
+    rejected += other.rejected;
+    for (size_t i = 0; i < s_sizeBuckets; ++i) {
+        recordSizes[i] += other.recordSizes[i];
+    }
+    for (size_t i = 0; i < 256; ++i) {
+        tags[i] += other.tags[i];
+    }
+}
+
+/*  Prints the report. Phase times are summed over the threads, so they may exceed the wall time */
+void ConversionStats::Print(std::ostream& out, double seconds) const
+{
+    std::ios::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(3);
+
+    out << "Wall time:    " << seconds << " s" << std::endl;
+    out << "Lines:        " << lines << ", converted: " << records << ", rejected: " << rejected << std::endl;
+    out << "Bytes in:     " << bytesIn << ", out: " << bytesOut << std::endl;
+    if (seconds > 0) {
+        out << "Records/s:    " << static_cast<uint64_t>(records / seconds)
+            << ", MB/s in: " << bytesIn / seconds / (1024 * 1024) << std::endl;
+    }
+
+    out << "Phases (thread time):" << std::endl;
+    for (size_t i = 0; i < PhaseCount; ++i) {
+        out << "  " << std::left << std::setw(12) << s_phaseNames[i] << std::right << phaseNs[i] / 1e9 << " s" << std::endl;
+    }
+
+    out << "Record sizes:" << std::endl;
+    for (size_t k = 0; k < s_sizeBuckets; ++k)
+    {
+        if (recordSizes[k]) {
+            uint64_t from = k ? 1ULL << (k - 1) : 0;
+            out << "  [" << from << ", " << (k ? 1ULL << k : 1) << ")\t" << recordSizes[k] << std::endl;
+        }
+    }
+
+    out << "Tags:" << std::endl;
+    for (size_t tag = 0; tag < 256; ++tag)
+    {
+        if (tags[tag]) {
+            out << "  " << std::left << std::setw(12) << (tag < sizeof(s_tagNames) / sizeof(s_tagNames[0]) ? s_tagNames[tag] : "?")
+                << std::right << tags[tag] << std::endl;
+        }
+    }
+    out.flags(flags);
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "TLVObject.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <chrono>
+#include <ostream>
+
+
+/*  Counters of the conversion (--stats). Each worker thread fills its own instance - no atomics or locks on the hot path - and
+ *  they are merged when the run is over. A line costs a few clock reads and increments, plus a walk over the record's Tags.
+ *
+ *  Phases:  Read - reading the input and splitting it to the ranges/lines,  Parse - JSON lexing/parsing,  Encode - filling the
+ *  record and dictionary,  Dump - writing them out (with the io_uring writer it's just queueing). Records flushed while being
+ *  encoded (--flush-threshold) are not in the Tag counts - their bytes are gone by then.
+ */
+struct ConversionStats
+{
+    enum Phase { Read, Parse, Encode, Dump, PhaseCount };
+
+    static const size_t s_sizeBuckets = 64;
+
+    /*  RAII timer adding its lifetime to the 'phase'. Does nothing if 'stats' is nullptr */
+    class Timer
+    {
+    public:
+        Timer(ConversionStats* stats, Phase phase)
+            : m_stats(stats)
+            , m_phase(phase)
+        {
+            if (m_stats) {
+                m_start = std::chrono::steady_clock::now();
+            }
+        }
+
+        ~Timer()
+        {
+            if (m_stats) {
+                m_stats->phaseNs[m_phase] += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                 std::chrono::steady_clock::now() - m_start).count();
+            }
+        }
+
+        Timer(const Timer&) = delete;
+
+        Timer& operator=(const Timer&) = delete;
+
+    private:
+        ConversionStats*                      m_stats;
+        Phase                                 m_phase;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    /*  Counts the converted record (sizes and Tags) and its dictionary */
+    void AddRecord(const TLVObject& record, size_t recordSize, size_t dictSize);
+
+    /*  Adds the counters of the other thread */
+    void Merge(const ConversionStats& other);
+
+    /*  Prints the report, 'seconds' is the wall time of the run */
+    void Print(std::ostream& out, double seconds) const;
+
+    uint64_t phaseNs[PhaseCount] = {};
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+    uint64_t lines = 0;
+    uint64_t records = 0;
+    uint64_t rejected = 0;                          // Lines put to the rejects file
+    uint64_t recordSizes[s_sizeBuckets] = {};       // [k] - records of [2^(k-1), 2^k) bytes
+    uint64_t tags[256] = {};                        // By TLVObject::Tag (key IDs are counted too - they are U8 integers)
+};
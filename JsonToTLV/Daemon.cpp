@@ -0,0 +1,401 @@
+#include "Daemon.h"
+#include "JsonToTlvConverter.h"
+#include "OutputLayout.h"
+#include "OutputWriter.h"
+
+#include <iostream>
+
+#if __has_include(<sys/un.h>)
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <fstream>
+
+
+const size_t Daemon::s_maxPayload = 256 * 1024 * 1024;
+
+namespace
+{
+
+const size_t s_headerSize = 5;                  // type/status: u8 | size: u32
+const size_t s_readSize = 64 * 1024;
+
+inline void Put32(std::vector<uint8_t>& out, size_t pos, uint32_t val)
+{
+    for (size_t i = 0; i < 4; ++i) {
+        out[pos + i] = static_cast<uint8_t>(val >> (8 * i));
+    }
+}
+
+inline uint32_t Get32(const uint8_t* src)
+{
+    return static_cast<uint32_t>(src[0]) | (static_cast<uint32_t>(src[1]) << 8) | (static_cast<uint32_t>(src[2]) << 16) |
+           (static_cast<uint32_t>(src[3]) << 24);
+}
+
+/*  Appends the answer header, the payload size is patched by EndAnswer() */
+size_t BeginAnswer(std::vector<uint8_t>& out, Daemon::Status status)
+{
+    size_t pos = out.size();
+    out.resize(pos + s_headerSize);
+    out[pos] = status;
+    return pos;
+}
+
+void EndAnswer(std::vector<uint8_t>& out, size_t pos)
+{
+    Put32(out, pos + 1, static_cast<uint32_t>(out.size() - pos - s_headerSize));
+}
+
+void AppendError(std::vector<uint8_t>& out, const std::string& message)
+{
+    size_t pos = BeginAnswer(out, Daemon::Failed);
+    out.insert(out.end(), message.begin(), message.end());
+    EndAnswer(out, pos);
+}
+
+bool SendAll(int fd, const std::vector<uint8_t>& data)
+{
+    for (size_t sent = 0; sent < data.size(); )
+    {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+/*  Converts the file line by line with the connection's converter. Gives the number of lines or what's wrong */
+bool ConvertLines(JsonToTlvConverter& converter, OutputWriter& writer, const Options& options, const std::string& input,
+                  const std::string& outputDir, uint64_t& lines, std::string& error)
+{
+    std::ifstream in(input, std::ios::in | std::ios::binary);
+    if (!in.is_open())
+    {
+        error = "unable to open the input file: " + input;
+        return false;
+    }
+    OutputLayout layout(outputDir, options.shardLevels, options.sharding);
+    std::string line;
+    bool ok = true;
+    for (lines = 0; ok && std::getline(in, line); ++lines)
+    {
+        std::string recordName = layout.Path("record", lines);
+        std::string dictName = layout.Path("dict", lines);
+        if (recordName.empty() || dictName.empty())
+        {
+            error = "unable to create the output directory";
+            ok = false;
+        }
+        else if (!converter.Convert(line, recordName, dictName))
+        {
+            error = "line " + std::to_string(lines) + ": " + converter.LastError();
+            ok = false;
+        }
+    }
+    if (!writer.Finish() && ok)
+    {
+        error = "unable to write the output files";
+        ok = false;
+    }
+    return ok;
+}
+
+}   // namespace
+
+
+Daemon::Daemon(std::string socketPath, const Options& options)
+    : m_socketPath(std::move(socketPath))
+    , m_options(options)
+{}
+
+Daemon::~Daemon()
+{
+    if (m_listenFd >= 0)
+    {
+        close(m_listenFd);
+        unlink(m_socketPath.c_str());
+    }
+    for (int fd : m_wakeFds)
+    {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+/*  Binds the socket (an existing socket file is replaced). Returns false if it's not possible */
+bool Daemon::Listen()
+{
+    bool hasKeySet = !m_options.keysFile.empty();
+    if (hasKeySet)
+    {
+        std::vector<std::string> keys;
+        if (!KeySet::Load(m_options.keysFile, keys) || !m_keySet.Build(keys)) {
+            std::cout << "Unable to build the key set of: " << m_options.keysFile << std::endl;
+            return false;
+        }
+    }
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (m_socketPath.empty() || m_socketPath.length() >= sizeof(address.sun_path)) {
+        std::cout << "Wrong socket path: " << m_socketPath << std::endl;
+        return false;
+    }
+    memcpy(address.sun_path, m_socketPath.c_str(), m_socketPath.length() + 1);
+    unlink(m_socketPath.c_str());
+
+    m_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_listenFd < 0 || bind(m_listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(m_listenFd, SOMAXCONN) != 0 || pipe(m_wakeFds) != 0)
+    {
+        std::cout << "Unable to listen on the socket " << m_socketPath << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    size_t threads = m_options.threads ? m_options.threads : std::thread::hardware_concurrency();
+    m_workers.resize(threads ? threads : 1);
+    for (auto& worker : m_workers)
+    {
+        worker.reset(new Worker);
+        worker->writer = OutputWriter::Create(m_options.ioUring);
+        worker->converter.SetFlushThreshold(m_options.flushThreshold);
+        worker->converter.SetDictFormat(m_options.dictFormat);
+        worker->converter.SetOutputWriter(worker->writer.get());
+        if (hasKeySet) {
+            worker->converter.SetKeySet(&m_keySet);
+        }
+    }
+    return true;
+}
+
+/*  Serves the connections until Stop() */
+void Daemon::Serve()
+{
+    for (auto& worker : m_workers) {
+        worker->thread = std::thread([this, &worker] { Work(*worker); });
+    }
+
+    while (!m_stopped)
+    {
+        // While the queue is full the new connections are left to the listen backlog - a worker taking one wakes us up
+        bool full;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            full = m_waiting.size() >= m_workers.size();
+        }
+        pollfd fds[2] = { { m_wakeFds[0], POLLIN, 0 }, { full ? -1 : m_listenFd, POLLIN, 0 } };
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[0].revents)
+        {
+            char bytes[64];
+            ssize_t got = read(m_wakeFds[0], bytes, sizeof(bytes));
+            (void)got;
+            continue;
+        }
+
+        int fd = accept4(m_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_waiting.push_back(fd);
+        }
+        m_ready.notify_one();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopped = true;
+        for (int fd : m_waiting) {
+            close(fd);
+        }
+        m_waiting.clear();
+        for (const auto& worker : m_workers)
+        {
+            if (worker->fd >= 0) {
+                shutdown(worker->fd, SHUT_RDWR);            // Wakes the workers blocked in recv()
+            }
+        }
+    }
+    m_ready.notify_all();
+    for (const auto& worker : m_workers) {
+        worker->thread.join();
+    }
+}
+
+/*  Makes Serve() return, dropping the connections. May be called from any thread or a signal handler */
+void Daemon::Stop()
+{
+    m_stopped = true;
+    if (m_wakeFds[1] >= 0)
+    {
+        char byte = 0;
+        ssize_t written = write(m_wakeFds[1], &byte, 1);
+        (void)written;
+    }
+}
+
+/*  Worker's loop: takes the waiting connections and serves them until Stop() */
+void Daemon::Work(Worker& worker)
+{
+    while (true)
+    {
+        int fd;
+        bool wasFull;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_ready.wait(lock, [this] { return m_stopped || !m_waiting.empty(); });
+            if (m_stopped) {
+                return;
+            }
+            wasFull = m_waiting.size() >= m_workers.size();
+            fd = m_waiting.front();
+            m_waiting.pop_front();
+            worker.fd = fd;
+        }
+        if (wasFull)
+        {
+            char byte = 0;
+            ssize_t written = write(m_wakeFds[1], &byte, 1);    // Serve() may accept again
+            (void)written;
+        }
+
+        ServeConnection(worker, fd);
+
+        // The descriptor is closed out of the lock only after it's unlisted - Serve() never shuts a reused one down
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            worker.fd = -1;
+        }
+        close(fd);
+    }
+}
+
+/*  Serves the requests of one connection until the client closes it */
+void Daemon::ServeConnection(Worker& worker, int fd)
+{
+    JsonToTlvConverter& converter = worker.converter;
+    std::vector<uint8_t> in, out;
+    bool open = true;
+    while (open)
+    {
+        // All the requests read so far are answered at once - that's what makes the pipelining pay
+        size_t pos = 0;
+        while (in.size() - pos >= s_headerSize)
+        {
+            uint8_t type = in[pos];
+            size_t size = Get32(&in[pos + 1]);
+            if ((type != ConvertJson && type != ConvertFile) || size > s_maxPayload)
+            {
+                open = false;
+                break;
+            }
+            if (in.size() - pos - s_headerSize < size) {
+                break;
+            }
+            const char* payload = reinterpret_cast<const char*>(&in[pos + s_headerSize]);
+            pos += s_headerSize + size;
+
+            if (type == ConvertJson)
+            {
+                if (!converter.Convert(std::string_view(payload, size)))
+                {
+                    AppendError(out, converter.LastError());
+                    continue;
+                }
+                size_t answer = BeginAnswer(out, Ok);
+                const TLVObject& record = converter.Record();
+                size_t recordPos = out.size();
+                out.resize(recordPos + 4);
+                Put32(out, recordPos, static_cast<uint32_t>(record.Size()));
+                out.insert(out.end(), record.Data(), record.Data() + record.Size());
+                out.insert(out.end(), converter.DictionaryData(), converter.DictionaryData() + converter.DictionarySize());
+                EndAnswer(out, answer);
+            }
+            else
+            {
+                std::string request(payload, size);
+                size_t separator = request.find('\0');
+                std::string input = request.substr(0, separator);
+                std::string outputDir = separator == std::string::npos ? m_options.outputDir : request.substr(separator + 1);
+                uint64_t lines = 0;
+                std::string error;
+                if (!ConvertLines(converter, *worker.writer, m_options, input, outputDir, lines, error))
+                {
+                    AppendError(out, error);
+                    continue;
+                }
+                size_t answer = BeginAnswer(out, Ok);
+                for (size_t i = 0; i < 8; ++i) {
+                    out.push_back(static_cast<uint8_t>(lines >> (8 * i)));
+                }
+                EndAnswer(out, answer);
+            }
+        }
+        in.erase(in.begin(), in.begin() + pos);
+        if (!out.empty())
+        {
+            open = open && SendAll(fd, out);
+            out.clear();
+        }
+        if (!open) {
+            break;
+        }
+
+        size_t size = in.size();
+        in.resize(size + s_readSize);
+        ssize_t n;
+        do {
+            n = recv(fd, in.data() + size, s_readSize, 0);
+        } while (n < 0 && errno == EINTR);
+        in.resize(size + (n > 0 ? static_cast<size_t>(n) : 0));
+        open = n > 0;
+    }
+}
+
+#else
+
+const size_t Daemon::s_maxPayload = 0;
+
+Daemon::Daemon(std::string socketPath, const Options& options)
+    : m_socketPath(std::move(socketPath))
+    , m_options(options)
+{}
+
+Daemon::~Daemon() = default;
+
+/*  No Unix domain sockets on this platform */
+bool Daemon::Listen()
+{
+    std::cout << "Daemon mode is not supported on this platform" << std::endl;
+    return false;
+}
+
+void Daemon::Serve() {}
+
+void Daemon::Stop() {}
+
+void Daemon::Work(Worker&) {}
+
+void Daemon::ServeConnection(Worker&, int) {}
+
+#endif
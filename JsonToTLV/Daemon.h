@@ -0,0 +1,102 @@
+#pragma once
+#include "JsonToTlvConverter.h"
+#include "KeySet.h"
+#include "Options.h"
+#include "OutputWriter.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/*  Long-running conversion server on a Unix domain socket - the services converting many small payloads or files don't pay the
+ *  process start and the cold converter for each of them. The connections are served by a fixed set of workers (as many as
+ *  Options::threads), each keeping its warm JsonToTlvConverter and OutputWriter for all the connections it serves. So at most
+ *  'threads' connections are served at once:  as many more wait in the queue for a free worker, the rest - in the backlog.
+ *
+ *  Protocol: the client sends the requests, the server answers each of them in the same order. Requests may be pipelined - the
+ *  client doesn't need to wait for the answer before sending the next request; answers to the requests read in one go are sent
+ *  in one write. The pipelining client must read the answers while it's sending (or bound its requests in flight):  the server
+ *  stops reading while its answers are not taken. All the numbers are little endian.
+ *
+ *  Request     | type: u8 | size: u32 | payload |
+ *    'J'       - payload is a JSON line, the answer carries its record and dictionary
+ *    'F'       - payload is 'input path' or 'input path\0output directory', the file is converted to record_N/dict_N (the
+ *                daemon's options apply, Options::outputDir is the default directory), the answer carries the number of lines
+ *                converted
+ *  Answer      | status: u8 | size: u32 | payload |
+ *    status 0  - 'J': | record size: u32 | record | dictionary |,  'F': | lines: u64 |
+ *    status 1  - payload is the error message
+ *
+ *  The request of unknown type or bigger than s_maxPayload makes the server drop the connection.
+ */
+class Daemon
+{
+public:
+    static const size_t s_maxPayload;
+
+    enum Request : uint8_t
+    {
+        ConvertJson = 'J',
+        ConvertFile = 'F'
+    };
+
+    enum Status : uint8_t
+    {
+        Ok = 0,
+        Failed = 1
+    };
+
+public:
+    /*  The workers and their converters are set up by the 'options' (threads, flush threshold, dictionary format, io_uring, key
+     *  list file) */
+    Daemon(std::string socketPath, const Options& options);
+
+    ~Daemon();
+
+    Daemon(const Daemon&) = delete;
+
+    Daemon& operator=(const Daemon&) = delete;
+
+    /*  Binds the socket (an existing socket file is replaced). Returns false if it's not possible */
+    bool Listen();
+
+    /*  Serves the connections until Stop() */
+    void Serve();
+
+    /*  Makes Serve() return, dropping the connections. May be called from any thread or a signal handler */
+    void Stop();
+
+private:
+    struct Worker
+    {
+        std::thread                   thread;
+        JsonToTlvConverter            converter;
+        std::unique_ptr<OutputWriter> writer;
+        int                           fd = -1;      // Connection being served, guarded by m_mutex
+    };
+
+    /*  Worker's loop: takes the waiting connections and serves them until Stop() */
+    void Work(Worker& worker);
+
+    /*  Serves the requests of one connection until the client closes it */
+    void ServeConnection(Worker& worker, int fd);
+
+    std::string                          m_socketPath;
+    const Options&                       m_options;
+    KeySet                               m_keySet;
+    int                                  m_listenFd = -1;
+    int                                  m_wakeFds[2] = { -1, -1 };    // Stop() and the workers write to [1] to wake Serve()
+    std::atomic<bool>                    m_stopped { false };
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::mutex                           m_mutex;
+    std::condition_variable              m_ready;                      // A connection is waiting or the daemon stops
+    std::deque<int>                      m_waiting;                    // Accepted connections no worker has taken yet
+};
@@ -0,0 +1,94 @@
+#include "DictionaryStore.h"
+#include "KeyHash.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <filesystem>
+#include <system_error>
+
+
+const char* const DictionaryStore::s_indexName = "dict_index";
+
+DictionaryStore::DictionaryStore(std::string directory)
+    : m_directory(std::move(directory))
+{
+    if (!m_directory.empty() && m_directory.back() != '/') {
+        m_directory += '/';
+    }
+}
+
+/*  Creates the directory and the index file */
+bool DictionaryStore::Open()
+{
+    std::error_code error;
+    if (!m_directory.empty()) {
+        std::filesystem::create_directories(m_directory, error);
+    }
+    m_index.open(m_directory + s_indexName, std::ios::out | std::ios::binary | std::ios::trunc);
+    return !error && m_index.is_open();
+}
+
+/*  References the dictionary 'data' from the record of the 'line' */
+bool DictionaryStore::Reference(uint64_t line, const uint8_t* data, size_t size, bool& isNew)
+{
+    static const char s_hex[] = "0123456789abcdef";
+    uint64_t hash = KeyHash::Hash(std::string_view(reinterpret_cast<const char*>(data), size));
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::vector<Stored>& candidates = m_stored[hash];
+    const Stored* found = nullptr;
+    for (const Stored& stored : candidates)
+    {
+        if (stored.data.size() == size && memcmp(stored.data.data(), data, size) == 0)
+        {
+            found = &stored;
+            break;
+        }
+    }
+    isNew = found == nullptr;
+    if (isNew)
+    {
+        Stored stored;
+        stored.data.assign(data, data + size);
+        stored.name = "dict_";
+        for (int shift = 60; shift >= 0; shift -= 4) {
+            stored.name += s_hex[(hash >> shift) & 0xF];
+        }
+        if (!candidates.empty()) {
+            stored.name += "_" + std::to_string(candidates.size());
+        }
+
+        // Under the lock - the other lines having the dictionary wait for its file instead of indexing it before it exists
+        std::ofstream file(m_directory + stored.name, std::ios::out | std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(data), size);
+        file.close();
+        if (file.fail())
+        {
+            std::remove((m_directory + stored.name).c_str());
+            return false;
+        }
+        candidates.push_back(std::move(stored));
+        found = &candidates.back();
+        ++m_distinct;
+    }
+    m_index << line << '\t' << found->name << '\n';
+    return static_cast<bool>(m_index);
+}
+
+/*  Flushes the index. Returns false if it has failed to write */
+bool DictionaryStore::Close()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_index.is_open()) {
+        return true;
+    }
+    m_index.close();
+    return !m_index.fail();
+}
+
+/*  Gets the number of the distinct dictionaries */
+size_t DictionaryStore::Distinct() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_distinct;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/*  Content-addressed dictionaries of one output directory. Lines of the same shape give byte-identical dictionaries, so each
+ *  distinct one is written once as 'dict_<hash>' (16 hex digits of its content hash), and the lines reference it in the index
+ *  file 'dict_index' - a 'N<TAB>dict_<hash>' line per record_N. Dictionary files take O(distinct shapes) instead of O(lines).
+ *
+ *  The store is shared by the workers converting the lines of the directory's input, so it's thread-safe.  Dictionaries seen
+ *  are kept in memory (these are a few) - a hash match is confirmed by comparing the bytes, the colliding dictionary gets the
+ *  '_1', '_2'... suffix. The store writes the new dictionary itself, right away:  a line is indexed only when its dictionary
+ *  file exists, so the index never points to a missing file.
+ */
+class DictionaryStore
+{
+public:
+    static const char* const s_indexName;
+
+public:
+    explicit DictionaryStore(std::string directory);
+
+    DictionaryStore(const DictionaryStore&) = delete;
+
+    DictionaryStore& operator=(const DictionaryStore&) = delete;
+
+    /*  Creates the directory and the index file */
+    bool Open();
+
+    /*  References the dictionary 'data' from the record of the 'line', writing its file if it's seen for the first time ('isNew'
+     *  tells it). Returns false if the dictionary file or the index is not writable - the line is not indexed then */
+    bool Reference(uint64_t line, const uint8_t* data, size_t size, bool& isNew);
+
+    /*  Flushes the index. Returns false if it has failed to write */
+    bool Close();
+
+    /*  Gets the number of the distinct dictionaries */
+    size_t Distinct() const;
+
+private:
+    struct Stored
+    {
+        std::vector<uint8_t> data;
+        std::string          name;
+    };
+
+    std::string                                         m_directory;
+    std::ofstream                                       m_index;
+    std::unordered_map<uint64_t, std::vector<Stored>>   m_stored;  // By the content hash
+    size_t                                              m_distinct = 0;
+    mutable std::mutex                                  m_mutex;
+};
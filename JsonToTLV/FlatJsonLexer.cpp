@@ -0,0 +1,217 @@
+#include "FlatJsonLexer.h"
+#include "JsonStringDecoder.h"
+
+#include <algorithm>
+#include <string.h>
+
+
+namespace
+{
+
+inline const char* SkipSpaces(const char* p, const char* end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+        ++p;
+    }
+    return p;
+}
+
+/*  Finds the string body - 'p' points to the opening quote. Escapes and UTF-8 are not checked here, they are left for the
+ *  JsonStringDecoder - lexer just sets 'plain' to false if the body has them */
+inline bool ReadString(const char*& p, const char* end, std::string_view& str, bool& plain)
+{
+    const char* begin = ++p;
+    plain = true;
+    while (true)
+    {
+        p = JsonStringDecoder::Scan(p, end);
+        if (p == end) {
+            return false;
+        }
+        uint8_t c = static_cast<uint8_t>(*p);
+        if (c == '"') {
+            break;
+        }
+        if (c == '\\')
+        {
+            if (end - p < 2) {
+                return false;
+            }
+            p += 2;                             // Escaped char can't close the string
+        }
+        else if (c < 0x20) {
+            return false;
+        }
+        else {
+            ++p;                                // Non-ASCII char
+        }
+        plain = false;
+    }
+    str = std::string_view(begin, p - begin);
+    ++p;
+    return true;
+}
+
+/*  Replaces the key having escapes or non-ASCII chars by its decoded copy in the arena */
+inline bool DecodeKey(FlatJsonLexer::Field& field)
+{
+    uint8_t* decoded = ArenaAllocator<uint8_t>().allocate(field.key.length());
+    size_t length;
+    if (!JsonStringDecoder::Decode(field.key, decoded, length)) {
+        return false;
+    }
+    field.key = std::string_view(reinterpret_cast<const char*>(decoded), length);
+    return true;
+}
+
+/*  Reads the JSON integer. Floats, leading zeros and values which don't fit into 64 bits are left for the general parser */
+inline bool ReadInteger(const char*& p, const char* end, FlatJsonLexer::Field& field)
+{
+    bool negative = *p == '-';
+    if (negative) {
+        ++p;
+    }
+    if (p == end || *p < '0' || *p > '9') {
+        return false;
+    }
+    const char* digits = p;
+    uint64_t value = 0;
+    while (p < end && *p >= '0' && *p <= '9')
+    {
+        uint64_t digit = *p - '0';
+        if (value > (UINT64_MAX - digit) / 10) {
+            return false;
+        }
+        value = value * 10 + digit;
+        ++p;
+    }
+    if ((*digits == '0' && p - digits > 1) || (p < end && (*p == '.' || *p == 'e' || *p == 'E'))) {
+        return false;
+    }
+
+    if (negative)
+    {
+        if (value > static_cast<uint64_t>(INT64_MAX) + 1) {
+            return false;
+        }
+        field.type = FlatJsonLexer::ValueType::Signed;
+        field.integer = static_cast<int64_t>(0 - value);
+    }
+    else
+    {
+        field.type = FlatJsonLexer::ValueType::Unsigned;
+        field.unsignedInteger = value;
+    }
+    return true;
+}
+
+inline bool ReadLiteral(const char*& p, const char* end, const char* literal, size_t length)
+{
+    if (static_cast<size_t>(end - p) < length || memcmp(p, literal, length) != 0) {
+        return false;
+    }
+    p += length;
+    return true;
+}
+
+/*  Orders the keys the same way std::map<std::string> of the general parser does */
+inline int CompareKeys(const FlatJsonLexer::Field& a, const FlatJsonLexer::Field& b)
+{
+    return a.key.compare(b.key);
+}
+
+}   // namespace
+
+
+/*  Parses the 'line' to the 'fields' sorted by key. Returns false if the line is not a flat object the lexer can handle */
+bool FlatJsonLexer::Parse(std::string_view line, Fields& fields)
+{
+    const char* p = line.data();
+    const char* end = p + line.length();
+    bool sorted = true;
+
+    fields.clear();
+    p = SkipSpaces(p, end);
+    if (p == end || *p++ != '{') {
+        return false;
+    }
+
+    while (true)
+    {
+        Field field;
+        bool plainKey;
+        p = SkipSpaces(p, end);
+        if (p == end || *p != '"' || !ReadString(p, end, field.key, plainKey)) {
+            return false;
+        }
+        if (!plainKey && !DecodeKey(field)) {
+            return false;
+        }
+        p = SkipSpaces(p, end);
+        if (p == end || *p++ != ':') {
+            return false;
+        }
+        p = SkipSpaces(p, end);
+        if (p == end) {
+            return false;
+        }
+
+        switch (*p) {
+            case '"':
+                field.type = ValueType::String;
+                if (!ReadString(p, end, field.str, field.strPlain)) {
+                    return false;
+                }
+                break;
+            case 't':
+                field.type = ValueType::Bool;
+                field.boolean = true;
+                if (!ReadLiteral(p, end, "true", 4)) {
+                    return false;
+                }
+                break;
+            case 'f':
+                field.type = ValueType::Bool;
+                field.boolean = false;
+                if (!ReadLiteral(p, end, "false", 5)) {
+                    return false;
+                }
+                break;
+            default:
+                if (!ReadInteger(p, end, field)) {
+                    return false;
+                }
+        }
+        if (!fields.empty() && sorted) {
+            sorted = CompareKeys(fields.back(), field) < 0;
+        }
+        fields.push_back(field);
+
+        p = SkipSpaces(p, end);
+        if (p == end) {
+            return false;
+        }
+        if (*p == '}') {
+            break;
+        }
+        if (*p++ != ',') {
+            return false;
+        }
+    }
+    if (SkipSpaces(p + 1, end) != end) {
+        return false;
+    }
+
+    // Machine-generated lines usually come with the same key order, often a sorted one - then there is nothing to do
+    if (!sorted)
+    {
+        std::sort(fields.begin(), fields.end(), [](const Field& a, const Field& b) { return CompareKeys(a, b) < 0; });
+        for (size_t i = 1; i < fields.size(); ++i)
+        {
+            if (CompareKeys(fields[i - 1], fields[i]) == 0) {
+                return false;                   // Duplicate keys - leave the "last one wins" semantic to the general parser
+            }
+        }
+    }
+    return true;
+}
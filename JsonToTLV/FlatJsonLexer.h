@@ -0,0 +1,50 @@
+#pragma once
+#include "Arena.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+#include <vector>
+
+
+/*  Hand-tuned lexer for the JSON line shape the convertor is made for:  one flat object of booleans, integers and strings, like
+ *  {"key1":true, "key2":234, "key3":"sdfdgv"}
+ *  It doesn't build any DOM - fields are returned as the slices of the input line, string values are found with SIMD scanning.
+ *  String values with escapes or non-ASCII chars are marked as not 'strPlain' - they are to be decoded with JsonStringDecoder
+ *  (keys are decoded by the lexer itself to the Arena::Current(), since they are needed for ordering).
+ *
+ *  The lexer doesn't report errors: anything outside of this shape (nesting, null, floats, duplicate keys, integer overflow,
+ *  broken syntax...)  just makes Parse() return false,  so that the caller falls back to the general JSON parser, which either
+ *  handles the line or tells what's wrong with it. The same goes for the caller if it fails to decode a string value.
+ *
+ *  To give the same output as the general parser does, fields are ordered by key (nlohmann::json keeps objects in std::map).
+ */
+class FlatJsonLexer
+{
+public:
+    enum class ValueType : uint8_t {
+        Bool,
+        Signed,                         // Negative integers (and "-0") - the general parser gives them as number_integer
+        Unsigned,                       // Non-negative integers - number_unsigned for the general parser
+        String
+    };
+
+    struct Field
+    {
+        std::string_view key;
+        std::string_view str;           // String value - slice of the input line, without quotes
+        bool             strPlain;      // String value has no escapes and non-ASCII chars - it can be copied as is
+        union {
+            bool     boolean;
+            int64_t  integer;
+            uint64_t unsignedInteger;
+        };
+        ValueType        type;
+    };
+
+    using Fields = std::vector<Field, ArenaAllocator<Field>>;
+
+public:
+    /*  Parses the 'line' to the 'fields' sorted by key. Returns false if the line is not a flat object the lexer can handle */
+    static bool Parse(std::string_view line, Fields& fields);
+};
@@ -0,0 +1,269 @@
+#include "JsonStringDecoder.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define JSON_STRING_DECODER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+namespace
+{
+
+/*  Index of the lowest set bit of the non-zero 'mask' */
+inline unsigned LowestBit(uint32_t mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+inline int HexDigit(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/*  Reads 4 hex digits of the \uXXXX escape */
+inline bool ReadHex4(const char* p, uint32_t& value)
+{
+    value = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        int digit = HexDigit(p[i]);
+        if (digit < 0) {
+            return false;
+        }
+        value = (value << 4) | static_cast<uint32_t>(digit);
+    }
+    return true;
+}
+
+inline uint8_t* PutUtf8(uint8_t* out, uint32_t cp)
+{
+    if (cp < 0x80)
+    {
+        *out++ = static_cast<uint8_t>(cp);
+    }
+    else if (cp < 0x800)
+    {
+        *out++ = static_cast<uint8_t>(0xC0 | (cp >> 6));
+        *out++ = static_cast<uint8_t>(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000)
+    {
+        *out++ = static_cast<uint8_t>(0xE0 | (cp >> 12));
+        *out++ = static_cast<uint8_t>(0x80 | ((cp >> 6) & 0x3F));
+        *out++ = static_cast<uint8_t>(0x80 | (cp & 0x3F));
+    }
+    else
+    {
+        *out++ = static_cast<uint8_t>(0xF0 | (cp >> 18));
+        *out++ = static_cast<uint8_t>(0x80 | ((cp >> 12) & 0x3F));
+        *out++ = static_cast<uint8_t>(0x80 | ((cp >> 6) & 0x3F));
+        *out++ = static_cast<uint8_t>(0x80 | (cp & 0x3F));
+    }
+    return out;
+}
+
+/*  Gets the length of the valid UTF-8 multibyte sequence at 'p' (RFC 3629, table 3-7 of the Unicode standard), 0 if invalid */
+inline size_t Utf8SequenceLength(const uint8_t* p, const uint8_t* end)
+{
+    uint8_t c = p[0];
+    size_t length;
+    uint8_t lo = 0x80, hi = 0xBF;               // Allowed range of the 2nd byte
+
+    if      (c >= 0xC2 && c <= 0xDF)    length = 2;
+    else if (c == 0xE0)               { length = 3; lo = 0xA0; }
+    else if (c >= 0xE1 && c <= 0xEC)    length = 3;
+    else if (c == 0xED)               { length = 3; hi = 0x9F; }
+    else if (c >= 0xEE && c <= 0xEF)    length = 3;
+    else if (c == 0xF0)               { length = 4; lo = 0x90; }
+    else if (c >= 0xF1 && c <= 0xF3)    length = 4;
+    else if (c == 0xF4)               { length = 4; hi = 0x8F; }
+    else                                return 0;
+
+    if (static_cast<size_t>(end - p) < length || p[1] < lo || p[1] > hi) {
+        return 0;
+    }
+    for (size_t i = 2; i < length; ++i)
+    {
+        if (p[i] < 0x80 || p[i] > 0xBF) {
+            return 0;
+        }
+    }
+    return length;
+}
+
+/*  Gets the number of chars the escape, multibyte char (or the char which is invalid there) at 'p' takes - surrogate pair of the
+ *  \uXXXX escapes is taken as one */
+inline size_t TokenLength(const char* p, const char* end)
+{
+    size_t left = end - p;
+    uint8_t c = static_cast<uint8_t>(*p);
+    if (c >= 0x80)
+    {
+        size_t seq = Utf8SequenceLength(reinterpret_cast<const uint8_t*>(p), reinterpret_cast<const uint8_t*>(end));
+        return seq ? seq : 1;
+    }
+    if (c != '\\' || left < 2) {
+        return 1;
+    }
+    if (p[1] != 'u') {
+        return 2;
+    }
+    uint32_t cp;
+    if (left >= 6 && ReadHex4(p + 2, cp) && cp >= 0xD800 && cp <= 0xDBFF) {
+        return left < 12 ? left : 12;
+    }
+    return left < 6 ? left : 6;
+}
+
+}   // namespace
+
+
+/*  Finds the first char in [p, end) which is a quote, backslash, control or non-ASCII char */
+const char* JsonStringDecoder::Scan(const char* p, const char* end)
+{
+#ifdef JSON_STRING_DECODER_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i space = _mm_set1_epi8(0x20);
+
+    for (; end - p >= 16; p += 16)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        // Signed compare with 0x20 catches both control chars and the non-ASCII ones (0x80...0xFF are negative)
+        __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                                       _mm_cmplt_epi8(chunk, space));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(special));
+        if (mask) {
+            return p + LowestBit(mask);
+        }
+    }
+#endif
+    for (; p < end; ++p)
+    {
+        uint8_t c = static_cast<uint8_t>(*p);
+        if (c == '"' || c == '\\' || c < 0x20 || c >= 0x80) {
+            return p;
+        }
+    }
+    return end;
+}
+
+/*  Validates and unescapes the string body 'src' to 'dst' */
+bool JsonStringDecoder::Decode(std::string_view src, uint8_t* dst, size_t& decodedLength)
+{
+    const char* p = src.data();
+    const char* end = p + src.length();
+    uint8_t* out = dst;
+
+    while (p < end)
+    {
+        const char* run = Scan(p, end);
+        memcpy(out, p, run - p);
+        out += run - p;
+        p = run;
+        if (p == end) {
+            break;
+        }
+
+        uint8_t c = static_cast<uint8_t>(*p);
+        if (c >= 0x80)
+        {
+            // Non-ASCII text usually goes in a row - validate it here rather than going back to Scan() after each char
+            const uint8_t* u = reinterpret_cast<const uint8_t*>(p);
+            const uint8_t* uend = reinterpret_cast<const uint8_t*>(end);
+            while (u < uend && *u >= 0x80)
+            {
+                size_t seq = Utf8SequenceLength(u, uend);
+                if (seq == 0) {
+                    return false;
+                }
+                memcpy(out, u, seq);
+                out += seq;
+                u += seq;
+            }
+            p = reinterpret_cast<const char*>(u);
+            continue;
+        }
+        if (c != '\\' || end - p < 2) {
+            return false;                       // Control char or unescaped quote
+        }
+
+        switch (p[1]) {
+            case '"':   *out++ = '"';   break;
+            case '\\':  *out++ = '\\';  break;
+            case '/':   *out++ = '/';   break;
+            case 'b':   *out++ = '\b';  break;
+            case 'f':   *out++ = '\f';  break;
+            case 'n':   *out++ = '\n';  break;
+            case 'r':   *out++ = '\r';  break;
+            case 't':   *out++ = '\t';  break;
+            case 'u':
+            {
+                uint32_t cp;
+                if (end - p < 6 || !ReadHex4(p + 2, cp)) {
+                    return false;
+                }
+                // High surrogate must be followed by the low one - together they give the code point above U+FFFF
+                if (cp >= 0xD800 && cp <= 0xDBFF)
+                {
+                    uint32_t low;
+                    if (end - p < 12 || p[6] != '\\' || p[7] != 'u' || !ReadHex4(p + 8, low) || low < 0xDC00 || low > 0xDFFF) {
+                        return false;
+                    }
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    p += 6;
+                }
+                else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                    return false;
+                }
+                out = PutUtf8(out, cp);
+                p += 6;
+                continue;
+            }
+            default:
+                return false;
+        }
+        p += 2;
+    }
+    decodedLength = out - dst;
+    return true;
+}
+
+/*  Gets the length of the head of 'src' up to 'maxLength' chars which may be decoded on its own */
+size_t JsonStringDecoder::PieceLength(std::string_view src, size_t maxLength)
+{
+    const char* begin = src.data();
+    const char* end = begin + src.length();
+    const char* p = begin;
+    if (maxLength >= src.length()) {
+        return src.length();
+    }
+
+    while (true)
+    {
+        const char* special = Scan(p, end);
+        if (static_cast<size_t>(special - begin) >= maxLength) {
+            return maxLength;                   // Plain run - may be cut anywhere
+        }
+        size_t token = TokenLength(special, end);
+        if (static_cast<size_t>(special - begin) + token > maxLength) {
+            return special > begin ? special - begin : token;
+        }
+        p = special + token;
+    }
+}
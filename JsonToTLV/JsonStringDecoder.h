@@ -0,0 +1,29 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+
+
+/*  Bulk processing of the JSON string bodies (the chars between the quotes):
+ *  -- Scan()   finds the first char which can't be taken as is - quote, escape, control or non-ASCII char. With SSE2 it checks 16
+ *              chars per iteration, so the plain ASCII runs cost about as much as memchr().
+ *  -- Decode() validates UTF-8 and unescapes the body to the caller's buffer:  plain runs found by Scan() are copied with memcpy,
+ *              only escapes and multibyte sequences are handled char by char.
+ *  Validation follows RFC 8259 / RFC 3629 the same way the nlohmann::json lexer does:  overlong forms, surrogates in UTF-8, code
+ *  points above U+10FFFF, unpaired \uXXXX surrogates and control chars are rejected.
+ */
+class JsonStringDecoder
+{
+public:
+    /*  Finds the first char in [p, end) which is a quote, backslash, control or non-ASCII char. Returns 'end' if there is none */
+    static const char* Scan(const char* p, const char* end);
+
+    /*  Decodes the string body 'src' to 'dst',  which must have the room for src.length() bytes (decoded string is never longer
+     *  than its JSON form).  Sets the 'decodedLength' and returns true if the body is a valid JSON string */
+    static bool Decode(std::string_view src, uint8_t* dst, size_t& decodedLength);
+
+    /*  Gets the length of the head of 'src' up to 'maxLength' chars which may be decoded on its own - it doesn't cut an escape,
+     *  a surrogate pair or a multibyte char. Only if the first of them is longer than 'maxLength' the head is longer. Decoding the
+     *  pieces one by one gives what decoding the whole body does, so a huge string may be decoded in bounded memory */
+    static size_t PieceLength(std::string_view src, size_t maxLength);
+};
@@ -0,0 +1,465 @@
+#include "JsonToTlvConverter.h"
+#include "FlatJsonLexer.h"
+#include "JsonStringDecoder.h"
+#include "KeySet.h"
+#include "Trace.h"
+
+#include "json.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string.h>
+
+using namespace nlohmann::detail;
+using namespace nlohmann;
+
+// JSON DOM living in the Arena::Current() - its nodes, keys and string values cost no malloc/free
+using ArenaJson = basic_json<std::map, std::vector, ArenaString, bool, std::int64_t, std::uint64_t, double, ArenaAllocator>;
+
+// Customization point json.hpp uses (found by ADL) to name the array elements in items()
+void int_to_string(ArenaString& target, std::size_t value)
+{
+    std::string str = std::to_string(value);
+    target.assign(str.data(), str.length());
+}
+
+
+
+namespace
+{
+
+/*  Key IDs of the line being encoded. Without the KeySet the keys are numbered in the line order (1, 2, 3...); with it the known
+ *  keys take their fixed IDs and the rest are numbered after them. Collects the "name":ID pairs of the dictionary */
+class KeyIds
+{
+public:
+    using Known = std::vector<uint8_t, ArenaAllocator<uint8_t>>;
+
+public:
+    KeyIds(const KeySet* keys, KeyMap& others)
+        : m_keys(keys)
+        , m_others(others)
+        , m_next(keys ? keys->Size() + 1 : 1)
+    {}
+
+    /*  Gives the ID of the next key of the line. Returns false if the IDs are over */
+    bool Assign(std::string_view key, uint8_t& id)
+    {
+        if (m_keys && (id = m_keys->Find(key)) != 0)
+        {
+            m_known.push_back(id);
+            return true;
+        }
+        if (m_next > UINT8_MAX) {
+            return false;
+        }
+        id = static_cast<uint8_t>(m_next++);
+        m_others.Set(key, id);
+        return true;
+    }
+
+    /*  Drops the IDs given so far */
+    void Clear()
+    {
+        m_known.clear();
+        m_others.Clear();
+        m_next = m_keys ? m_keys->Size() + 1 : 1;
+    }
+
+    bool Empty() const                      { return m_known.empty() && m_others.Empty(); }
+
+    /*  IDs of the known keys of the line, their names are in the KeySet */
+    const Known& KnownIds() const           { return m_known; }
+
+    /*  The other keys of the line */
+    const KeyMap& Others() const            { return m_others; }
+
+    const KeySet* Keys() const              { return m_keys; }
+
+private:
+    const KeySet*    m_keys;
+    KeyMap&          m_others;
+    Known            m_known;
+    size_t           m_next;
+};
+
+/*  Despite the JSON gives 64bit integers - we do narrow cast if possible to save tlv size */
+bool WriteSigned(TLVObject& tlv, int64_t num)
+{
+    if      (num >= INT8_MIN)       return tlv.WriteInteger(static_cast<int8_t>(num));
+    else if (num >= INT16_MIN)      return tlv.WriteInteger(static_cast<int16_t>(num));
+    else if (num >= INT32_MIN)      return tlv.WriteInteger(static_cast<int32_t>(num));
+    else                            return tlv.WriteInteger(static_cast<int64_t>(num));
+}
+
+bool WriteUnsigned(TLVObject& tlv, uint64_t num)
+{
+    if      (num <= UINT8_MAX)      return tlv.WriteInteger(static_cast<uint8_t>(num));
+    else if (num <= UINT16_MAX)     return tlv.WriteInteger(static_cast<uint16_t>(num));
+    else if (num <= UINT32_MAX)     return tlv.WriteInteger(static_cast<uint32_t>(num));
+    else                            return tlv.WriteInteger(static_cast<uint64_t>(num));
+}
+
+const size_t s_decodePieceSize = 64 * 1024;
+
+/*  Decodes the string bigger than the flush threshold piece by piece (see JsonStringDecoder::PieceLength), so the record never
+ *  holds the whole value. The Length field goes first - the body is decoded twice: to count the bytes, then to write them */
+bool WriteStreamedString(TLVObject& record, std::string_view str)
+{
+    std::vector<uint8_t> piece(s_decodePieceSize);
+    size_t length = 0;
+    for (size_t pos = 0; pos < str.length(); )
+    {
+        size_t size = JsonStringDecoder::PieceLength(str.substr(pos), piece.size());
+        size_t decoded;
+        piece.resize(std::max(piece.size(), size));
+        if (!JsonStringDecoder::Decode(str.substr(pos, size), piece.data(), decoded)) {
+            return false;
+        }
+        length += decoded;
+        pos += size;
+    }
+
+    size_t pos = 0, decoded = 0, given = 0;         // Decoded piece is in the [given, decoded) of the 'piece'
+    return record.WriteSizedString(length, [&](uint8_t* buffer, size_t capacity) -> size_t
+    {
+        if (given == decoded)
+        {
+            size_t size = JsonStringDecoder::PieceLength(str.substr(pos), s_decodePieceSize);
+            JsonStringDecoder::Decode(str.substr(pos, size), piece.data(), decoded);    // Validated by the first pass
+            pos += size;
+            given = 0;
+        }
+        size_t count = std::min(capacity, decoded - given);
+        memcpy(buffer, piece.data() + given, count);
+        given += count;
+        return count;
+    });
+}
+
+/*  Plain strings are copied as is, the ones with escapes or non-ASCII chars are decoded right into the record's buffer - or
+ *  streamed to the file if they are bigger than the flush threshold */
+bool WriteFlatString(TLVObject& record, const FlatJsonLexer::Field& field)
+{
+    if (field.strPlain) {
+        return record.WriteString(field.str);
+    }
+    if (record.Flushing() && field.str.length() > record.FlushThreshold()) {
+        return WriteStreamedString(record, field.str);
+    }
+    uint8_t* value = record.BeginString(field.str.length());
+    if (!value) {
+        return false;
+    }
+    size_t length = 0;
+    bool ok = JsonStringDecoder::Decode(field.str, value, length);
+    record.EndString(length);
+    return ok;
+}
+
+/*  Encodes the fields given by the FlatJsonLexer - straight from the input line, without any DOM */
+bool EncodeFlat(const FlatJsonLexer::Fields& fields, TLVObject& record, KeyIds& ids)
+{
+    TRACE_SPAN("encode record");
+    uint8_t k;                                       // This is to distinguish the keys inside one record (1:"qqq", 2:true, 3...)
+    bool ok = true;
+
+    for (const auto& field : fields)
+    {
+        if (!ids.Assign(field.key, k) || !record.WriteInteger(k))
+        {
+            ok = false;
+            break;
+        }
+        switch (field.type) {
+            case FlatJsonLexer::ValueType::Bool:        ok &= record.WriteBool(field.boolean);                       break;
+            case FlatJsonLexer::ValueType::String:      ok &= WriteFlatString(record, field);                        break;
+            case FlatJsonLexer::ValueType::Signed:      ok &= WriteSigned(record, field.integer);                    break;
+            case FlatJsonLexer::ValueType::Unsigned:    ok &= WriteUnsigned(record, field.unsignedInteger);          break;
+        }
+        if (!ok) {
+            break;
+        }
+    }
+    return ok;
+}
+
+/*  Describes the value the TLV has no room for */
+std::string UnsupportedValue(const ArenaJson& val, const ArenaString& key)
+{
+    const char* what;
+    switch (val.type()) {
+        case value_t::number_float:     what = "floating point value";  break;
+        case value_t::object:
+        case value_t::array:            what = "nested value";          break;
+        case value_t::null:             what = "null value";            break;
+        default:                        what = "unsupported value";
+    }
+    return std::string(what) + " of the key '" + std::string(key.data(), key.length()) + "'";
+}
+
+/*  Encodes the line parsed by the general JSON parser to the 'j'. The 'ids' reference the long keys of the 'j', so the caller
+ *  keeps it alive while the dictionary is being built. Tells what's wrong in the 'error' on failure */
+bool EncodeGeneral(std::string_view jsonString, ArenaJson& j, TLVObject& record, KeyIds& ids, ConversionStats* stats,
+                   std::string& error)
+{
+    uint8_t k;                                       // This is to distinguish the keys inside one record (1:"qqq", 2:true, 3...)
+    bool ok = true;
+
+    try {
+        ConversionStats::Timer timer(stats, ConversionStats::Parse);
+        TRACE_SPAN("json::parse");
+        j = ArenaJson::parse(jsonString.begin(), jsonString.end());
+    }
+    catch (const nlohmann::detail::exception& e) {
+        error = e.what();
+        return false;
+    }
+    if (!j.is_object() || j.empty())
+    {
+        error = j.is_object() ? "empty object" : "not an object";
+        return false;
+    }
+    ConversionStats::Timer timer(stats, ConversionStats::Encode);
+    TRACE_SPAN("encode record");
+
+    for (const auto& el : j.items())
+    {
+        const auto& val = el.value();
+        if (!ids.Assign(std::string_view(el.key().data(), el.key().length()), k))
+        {
+            error = "too many keys";
+            return false;
+        }
+        if (!(ok &= record.WriteInteger(k))) {
+            break;
+        }
+        switch (val.type()) {
+            case value_t::boolean:              ok &= record.WriteBool(val.get<bool>());                break;
+            case value_t::number_integer:       ok &= WriteSigned(record, val.get<int64_t>());          break;
+            case value_t::number_unsigned:      ok &= WriteUnsigned(record, val.get<uint64_t>());       break;
+            case value_t::string:
+            {
+                ok &= record.WriteString(val.get_ref<const ArenaString&>());
+                break;
+            }
+            default:
+                error = UnsupportedValue(val, el.key());
+                return false;
+        }
+        if (!ok) {
+            error = "unable to encode the value of the key '" + std::string(el.key().data(), el.key().length()) + "'";
+            break;
+        }
+    }
+    return ok;
+}
+
+}   // namespace
+
+
+/*  Converts one JSON line to the TLV record and dictionary kept inside the converter */
+bool JsonToTlvConverter::Convert(std::string_view jsonString)
+{
+    m_dict.Clear();
+    m_record.Clear();
+    m_indexedDict.clear();
+    return Encode(jsonString);
+}
+
+/*  Converts one JSON line and dumps the record and dictionary to the 'recordFileName' and 'dictFileName' */
+bool JsonToTlvConverter::Convert(std::string_view jsonString, const std::string& recordFileName, const std::string& dictFileName)
+{
+    if (m_flushThreshold == 0)
+    {
+        if (!Convert(jsonString)) {
+            return false;
+        }
+        if (m_stats) {
+            m_stats->AddRecord(m_record, m_record.Size(), dictFileName.empty() ? 0 : DictionarySize());
+        }
+        ConversionStats::Timer timer(m_stats, ConversionStats::Dump);
+        if (!Output(m_record, recordFileName))
+        {
+            m_lastError = "unable to write the record file";
+            return false;
+        }
+        if (!dictFileName.empty() && !OutputDictionary(dictFileName))
+        {
+            m_lastError = "unable to write the dictionary file";
+            return false;
+        }
+        return true;
+    }
+
+    // Record goes to its file while being encoded - so the memory doesn't grow with the line. The partial file of a failed line
+    // is removed
+    m_dict.Clear();
+    m_record.Clear();
+    m_indexedDict.clear();
+    if (!m_record.StartFlushing(recordFileName, m_flushThreshold)) {
+        m_lastError = "unable to open the record file";
+        return false;
+    }
+    bool ok = Encode(jsonString);
+    size_t recordSize = m_record.Size();
+    if (!m_record.FinishFlushing() && ok)
+    {
+        m_lastError = "unable to write the record file";
+        ok = false;
+    }
+    if (!ok)
+    {
+        std::remove(recordFileName.c_str());
+        return false;
+    }
+    if (m_stats) {
+        m_stats->AddRecord(m_record, recordSize, dictFileName.empty() ? 0 : DictionarySize());
+    }
+    if (!dictFileName.empty())
+    {
+        ConversionStats::Timer timer(m_stats, ConversionStats::Dump);
+        if (!OutputDictionary(dictFileName))
+        {
+            m_lastError = "unable to write the dictionary file";
+            return false;
+        }
+    }
+    return true;
+}
+
+/*  Converts the 'count' JSON 'lines' to the 'batch' */
+bool JsonToTlvConverter::ConvertBatch(const std::string_view* lines, size_t count, Batch& batch)
+{
+    batch.data.clear();
+    batch.offsets.clear();
+    batch.errors.clear();
+    batch.offsets.reserve(2 * count + 1);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        batch.offsets.push_back(batch.data.size());
+        if (!Convert(lines[i]))
+        {
+            batch.offsets.push_back(batch.data.size());
+            batch.errors.emplace_back(i, m_lastError);
+            continue;
+        }
+        if (m_stats) {
+            m_stats->AddRecord(m_record, m_record.Size(), DictionarySize());
+        }
+        batch.data.insert(batch.data.end(), m_record.Data(), m_record.Data() + m_record.Size());
+        batch.offsets.push_back(batch.data.size());
+        batch.data.insert(batch.data.end(), DictionaryData(), DictionaryData() + DictionarySize());
+    }
+    batch.offsets.push_back(batch.data.size());
+    return batch.errors.empty();
+}
+
+/*  Writes the 'tlv' to the 'fileName' - with the output writer if it's set */
+bool JsonToTlvConverter::Output(TLVObject& tlv, const std::string& fileName)
+{
+    TRACE_SPAN("dump");
+    if (m_writer) {
+        return m_writer->Write(fileName, tlv.Data(), tlv.Size());
+    }
+    return tlv.Dump(fileName);
+}
+
+/*  Writes the dictionary of the line in the chosen form to the 'fileName' */
+bool JsonToTlvConverter::OutputDictionary(const std::string& fileName)
+{
+    if (m_dictFormat == DictFormat::TLV) {
+        return Output(m_dict, fileName);
+    }
+    TRACE_SPAN("dump");
+    if (m_writer) {
+        return m_writer->Write(fileName, m_indexedDict.data(), m_indexedDict.size());
+    }
+    std::ofstream out(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(m_indexedDict.data()), m_indexedDict.size());
+    return static_cast<bool>(out);
+}
+
+/*  Gets the bytes of the dictionary of the last converted line in the chosen form */
+const uint8_t* JsonToTlvConverter::DictionaryData() const
+{
+    return m_dictFormat == DictFormat::TLV ? m_dict.Data() : m_indexedDict.data();
+}
+
+/*  Gets the size of the dictionary of the last converted line in the chosen form */
+size_t JsonToTlvConverter::DictionarySize() const
+{
+    return m_dictFormat == DictFormat::TLV ? m_dict.Size() : m_indexedDict.size();
+}
+
+/*  Encodes the line to the cleared record and dictionary */
+bool JsonToTlvConverter::Encode(std::string_view jsonString)
+{
+    // All the temporaries below are allocated in the converter's arena,  which is rewound when the 'scope' goes away - so it must
+    // be declared first
+    Arena::Scope scope(m_arena);
+    m_lastError.clear();
+    m_keyMap.Clear();                                // {"key1":1, "qwe":2, "keyEE":3...}
+    KeyIds ids(m_keySet, m_keyMap);
+    FlatJsonLexer::Fields fields;
+    ArenaJson dom;                                   // Of the general parser - its keys are in the 'ids' up to the dictionary
+    bool ok = false;
+
+    if (m_flatLexerEnabled)
+    {
+        {
+            ConversionStats::Timer timer(m_stats, ConversionStats::Parse);
+            TRACE_SPAN("flat lexer");
+            ok = FlatJsonLexer::Parse(jsonString, fields);
+        }
+        ConversionStats::Timer timer(m_stats, ConversionStats::Encode);
+        ok = ok && EncodeFlat(fields, m_record, ids);
+    }
+
+    // Whatever the fast path has declined or failed on (including invalid strings) - the general parser starts from scratch and
+    // either converts the line or tells what's wrong with it
+    if (!ok)
+    {
+        m_record.Clear();
+        ids.Clear();
+        ok = EncodeGeneral(jsonString, dom, m_record, ids, m_stats, m_lastError);
+    }
+    if (!ok || ids.Empty()) {
+        return false;
+    }
+
+    ConversionStats::Timer timer(m_stats, ConversionStats::Encode);
+    TRACE_SPAN("encode dictionary");
+
+    m_dictEntries.clear();
+    for (uint8_t id : ids.KnownIds()) {
+        m_dictEntries.emplace_back(ids.Keys()->Key(id), id);
+    }
+    for (const auto& entry : ids.Others()) {
+        m_dictEntries.emplace_back(entry.Key(), entry.Id());
+    }
+    // Key ID order - so the dictionary bytes depend on the line's keys only, not on the way they were resolved
+    std::sort(m_dictEntries.begin(), m_dictEntries.end(),
+              [](const TLVDictionary::Entry& a, const TLVDictionary::Entry& b) { return a.second < b.second; });
+
+    if (m_dictFormat == DictFormat::Indexed) {
+        ok = TLVDictionary::Build(m_dictEntries, m_indexedDict);
+    }
+    else
+    {
+        for (const auto& entry : m_dictEntries)
+        {
+            if (!(ok = m_dict.WriteString(entry.first) && m_dict.WriteInteger(entry.second))) {
+                break;
+            }
+        }
+    }
+    if (!ok) {
+        m_lastError = "unable to encode the dictionary";
+    }
+    return ok;
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include "Arena.h"
+#include "ConversionStats.h"
+#include "KeyMap.h"
+#include "KeySet.h"
+#include "OutputWriter.h"
+#include "TLVDictionary.h"
+#include "TLVObject.h"
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+/*  Converts JSON lines to the TLV record and dictionary, keeping all its scratch state between the lines:  the JSON DOM is built
+ *  in the converter's own Arena (rewound after each line), the key map and output TLVObjects are cleared but keep their
+ *  capacity. So after the first few lines the conversion works without touching the heap.
+ *
+ *  Converter is not thread-safe - the parallel pipeline is supposed to have one instance per thread. The record and dictionary
+ *  of the last successful Convert() stay available via Record()/Dictionary() up to the next Convert() call.
+ */
+class JsonToTlvConverter
+{
+public:
+    /*  Form of the dictionary: 'TLV' - the "name":ID pairs as TLV strings and integers, 'Indexed' - TLVDictionary, which may
+     *  be looked up by name or ID right in the file bytes */
+    enum class DictFormat
+    {
+        TLV,
+        Indexed
+    };
+
+    /*  Output of ConvertBatch(): records and dictionaries of all the lines in one contiguous buffer - ready to be written or sent
+     *  at once. Kept between the batches, so its memory is reused */
+    struct Batch
+    {
+        std::vector<uint8_t> data;          // Record and dictionary of the 1st line, of the 2nd one...
+        std::vector<size_t>  offsets;       // Record and dictionary starts of every line, then the end of the data
+        std::vector<std::pair<size_t, std::string>> errors;     // Lines failed to convert (they take no bytes) and the reasons
+
+        size_t Count() const                            { return offsets.size() / 2; }
+
+        const uint8_t* Record(size_t i) const           { return data.data() + offsets[2 * i]; }
+
+        size_t RecordSize(size_t i) const               { return offsets[2 * i + 1] - offsets[2 * i]; }
+
+        const uint8_t* Dictionary(size_t i) const       { return data.data() + offsets[2 * i + 1]; }
+
+        size_t DictionarySize(size_t i) const           { return offsets[2 * i + 2] - offsets[2 * i + 1]; }
+    };
+
+public:
+    JsonToTlvConverter() = default;
+
+    JsonToTlvConverter(const JsonToTlvConverter&) = delete;
+
+    JsonToTlvConverter& operator=(const JsonToTlvConverter&) = delete;
+
+    /*  Converts one JSON line to the TLV record and dictionary kept inside the converter */
+    bool Convert(std::string_view jsonString);
+
+    /*  Converts one JSON line and dumps the record and dictionary to the 'recordFileName' and 'dictFileName'. With empty
+     *  'dictFileName' the dictionary is not written - it's left for the caller (see DictionaryData()) */
+    bool Convert(std::string_view jsonString, const std::string& recordFileName, const std::string& dictFileName);
+
+    /*  Converts the 'count' JSON 'lines' to the 'batch'. Returns false if any of them has failed (see Batch::errors) */
+    bool ConvertBatch(const std::string_view* lines, size_t count, Batch& batch);
+
+    /*  Enables/disables the fast path for the flat JSON objects (see FlatJsonLexer). Enabled by default; the output is the same
+     *  either way */
+    void EnableFlatLexer(bool enable)   { m_flatLexerEnabled = enable; }
+
+    /*  Makes Convert() to the files stream the record to its file whenever more than 'threshold' bytes are encoded, so a huge
+     *  line doesn't need the whole record in memory (see TLVObject::StartFlushing()). 0 (default) - dump the record at once */
+    void SetFlushThreshold(size_t threshold)    { m_flushThreshold = threshold; }
+
+    /*  Makes Convert() to the files create them with the 'writer' (not owned, may be nullptr) instead of TLVObject::Dump() */
+    void SetOutputWriter(OutputWriter* writer)  { m_writer = writer; }
+
+    /*  Sets the form the dictionary is encoded in (DictFormat::TLV by default) */
+    void SetDictFormat(DictFormat format)       { m_dictFormat = format; }
+
+    /*  Makes the known keys take their fixed IDs from the 'keys' (not owned, nullptr - number the keys in the line order),
+     *  the other keys of a line are numbered after them. A line runs out of the IDs if the set leaves no room for its unknown
+     *  keys */
+    void SetKeySet(const KeySet* keys)          { m_keySet = keys; }
+
+    /*  Makes the converter count its phases and records to the 'stats' (not owned, nullptr - don't count) */
+    void SetStats(ConversionStats* stats)       { m_stats = stats; }
+
+    /*  Gets what was wrong with the last line which has failed to convert */
+    const std::string& LastError() const        { return m_lastError; }
+
+    /*  Gets the record of the last converted line */
+    const TLVObject& Record() const     { return m_record; }
+
+    /*  Gets the dictionary of the last converted line */
+    const TLVObject& Dictionary() const { return m_dict; }
+
+    /*  Gets the indexed dictionary of the last converted line (empty unless DictFormat::Indexed is set) */
+    const std::vector<uint8_t>& IndexedDictionary() const   { return m_indexedDict; }
+
+    /*  Gets the bytes of the dictionary of the last converted line in the chosen form. The pairs go in the key ID order, so the
+     *  lines of the same shape give the same bytes */
+    const uint8_t* DictionaryData() const;
+
+    /*  Gets the size of the dictionary of the last converted line in the chosen form */
+    size_t DictionarySize() const;
+
+private:
+    /*  Encodes the line to the cleared record and dictionary */
+    bool Encode(std::string_view jsonString);
+
+    /*  Writes the 'tlv' to the 'fileName' - with the output writer if it's set */
+    bool Output(TLVObject& tlv, const std::string& fileName);
+
+    /*  Writes the dictionary of the line in the chosen form to the 'fileName' */
+    bool OutputDictionary(const std::string& fileName);
+
+    Arena                             m_arena;        // Scratch memory for the JSON DOM of the line
+    TLVObject                         m_record;
+    TLVObject                         m_dict;
+    OutputWriter*                     m_writer = nullptr;
+    ConversionStats*                  m_stats = nullptr;
+    const KeySet*                     m_keySet = nullptr;
+    KeyMap                            m_keyMap;       // Keys of the line the KeySet doesn't know
+    std::vector<uint8_t>              m_indexedDict;
+    std::vector<TLVDictionary::Entry> m_dictEntries;  // Scratch for building the dictionary
+    std::string                       m_lastError;
+    size_t                            m_flushThreshold = 0;
+    DictFormat                        m_dictFormat = DictFormat::TLV;
+    bool                              m_flatLexerEnabled = true;
+};
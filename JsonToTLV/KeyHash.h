@@ -0,0 +1,83 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+/*  Fast hash of the JSON keys (wyhash-style):  the key is read by 8-byte words (short keys by two overlapping loads), which are
+ *  folded with the 64x64=>128 bit multiplication. Keys are short, so it's a handful of instructions - much less than the byte
+ *  loop of std::hash. The words are read as little endian whatever the machine is (a plain load on x86/ARM), so the values are
+ *  the same everywhere and may be stored - DictionaryStore names the files by them.
+ */
+namespace KeyHash
+{
+
+const uint64_t s_secret0 = 0xA0761D6478BD642FULL;
+const uint64_t s_secret1 = 0xE7037ED1A0B428DBULL;
+
+inline uint64_t Mum(uint64_t a, uint64_t b)
+{
+#ifdef _MSC_VER
+    uint64_t hi;
+    uint64_t lo = _umul128(a, b, &hi);
+    return lo ^ hi;
+#else
+    __uint128_t r = static_cast<__uint128_t>(a) * b;
+    return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+#endif
+}
+
+/*  Little endian reads - the compilers turn the loops to a single load (plus 'bswap' on the big endian machines) */
+inline uint64_t Read64(const uint8_t* p)
+{
+    uint64_t v = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        v |= static_cast<uint64_t>(p[i]) << (8 * i);
+    }
+    return v;
+}
+
+inline uint64_t Read32(const uint8_t* p)
+{
+    uint64_t v = 0;
+    for (size_t i = 0; i < 4; ++i) {
+        v |= static_cast<uint64_t>(p[i]) << (8 * i);
+    }
+    return v;
+}
+
+/*  Hashes the 'key', different 'seed's give independent hash functions */
+inline uint64_t Hash(std::string_view key, uint64_t seed = 0)
+{
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(key.data());
+    size_t n = key.length();
+    uint64_t h = seed ^ s_secret0;
+    uint64_t a = 0, b = 0;
+
+    while (n > 16)
+    {
+        h = Mum(Read64(p) ^ s_secret1, Read64(p + 8) ^ h);
+        p += 16;
+        n -= 16;
+    }
+    if (n >= 8)
+    {
+        a = Read64(p);
+        b = Read64(p + n - 8);
+    }
+    else if (n >= 4)
+    {
+        a = Read32(p);
+        b = Read32(p + n - 4);
+    }
+    else if (n > 0) {
+        a = (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[n >> 1]) << 8) | p[n - 1];
+    }
+    return Mum(s_secret1 ^ key.length(), Mum(a ^ s_secret1, b ^ h));
+}
+
+}   // namespace KeyHash
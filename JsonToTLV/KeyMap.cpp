@@ -0,0 +1,96 @@
+#include "KeyMap.h"
+
+#include <string.h>
+
+
+namespace
+{
+
+const size_t s_initialSlots = 64;
+
+}   // namespace
+
+
+KeyMap::KeyMap()
+    : m_table(s_initialSlots)
+    , m_mask(s_initialSlots - 1)
+{
+    m_entries.reserve(s_initialSlots / 2);
+}
+
+/*  Sets the 'id' of the 'key' (replaces the ID if the key is in the map already) */
+void KeyMap::Set(std::string_view key, uint8_t id)
+{
+    if ((m_entries.size() + 1) * 2 > m_table.size()) {
+        Grow();
+    }
+    uint64_t hash = KeyHash::Hash(key);
+    size_t slot = Probe(key, hash);
+    if (m_table[slot].tag)
+    {
+        m_entries[m_table[slot].entry].m_id = id;
+        return;
+    }
+
+    Entry entry;
+    if (key.length() <= s_inlineSize) {
+        memcpy(entry.m_inlineKey, key.data(), key.length());
+    }
+    else {
+        entry.m_longKey = key.data();
+    }
+    entry.m_id = id;
+    entry.m_length = static_cast<uint32_t>(key.length());
+    entry.m_slot = static_cast<uint32_t>(slot);
+    m_table[slot].tag = TagOf(hash);
+    m_table[slot].entry = static_cast<uint32_t>(m_entries.size());
+    m_entries.push_back(entry);
+}
+
+/*  Gets the ID of the 'key' (0 if there is no such key) */
+uint8_t KeyMap::Find(std::string_view key) const
+{
+    size_t slot = Probe(key, KeyHash::Hash(key));
+    return m_table[slot].tag ? m_entries[m_table[slot].entry].m_id : 0;
+}
+
+/*  Removes all the keys, keeping the memory */
+void KeyMap::Clear()
+{
+    for (const Entry& entry : m_entries) {
+        m_table[entry.m_slot] = Slot();
+    }
+    m_entries.clear();
+}
+
+/*  Finds the slot of the 'key' or the free slot it should take */
+size_t KeyMap::Probe(std::string_view key, uint64_t hash) const
+{
+    uint32_t tag = TagOf(hash);
+    for (size_t slot = HomeSlot(hash); ; slot = (slot + 1) & m_mask)
+    {
+        const Slot& s = m_table[slot];
+        if (s.tag == 0 || (s.tag == tag && m_entries[s.entry].Key() == key)) {
+            return slot;
+        }
+    }
+}
+
+/*  Doubles the table */
+void KeyMap::Grow()
+{
+    m_table.assign(m_table.size() * 2, Slot());
+    m_mask = m_table.size() - 1;
+    for (size_t i = 0; i < m_entries.size(); ++i)
+    {
+        Entry& entry = m_entries[i];
+        uint64_t hash = KeyHash::Hash(entry.Key());
+        size_t slot = HomeSlot(hash);
+        while (m_table[slot].tag) {
+            slot = (slot + 1) & m_mask;
+        }
+        m_table[slot].tag = TagOf(hash);
+        m_table[slot].entry = static_cast<uint32_t>(i);
+        entry.m_slot = static_cast<uint32_t>(slot);
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "KeyHash.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+#include <vector>
+
+class KeyMapTester;
+
+
+/*  Key => ID map of one line, made to be cleared and refilled for every line without touching the heap:
+ *
+ *  - entries are kept in a dense array in the insertion order (so iteration is cache friendly and deterministic), keys up to
+ *    s_inlineSize bytes are copied right into the entry, longer ones are referenced - they must stay alive up to Clear();
+ *  - the table is open-addressing with linear probing over a power-of-2 number of slots:  the low bits of the key's hash
+ *    (KeyHash) pick the home slot, a slot keeps the entry index and the upper bits of the hash as a tag, so most of the mismatches
+ *    are told without touching the entry;
+ *  - Clear() empties just the slots in use, the memory is kept for the next line.
+ */
+class KeyMap
+{
+    friend class KeyMapTester;
+
+public:
+    static const size_t s_inlineSize = 22;
+
+    class Entry
+    {
+    public:
+        std::string_view Key() const
+        {
+            return std::string_view(m_length <= s_inlineSize ? m_inlineKey : m_longKey, m_length);
+        }
+
+        uint8_t Id() const      { return m_id; }
+
+    private:
+        friend class KeyMap;
+
+        union {
+            char        m_inlineKey[s_inlineSize];
+            const char* m_longKey;
+        };
+        uint8_t  m_id;
+        uint32_t m_length;
+        uint32_t m_slot;        // Slot of the table taken by the entry
+    };
+
+public:
+    KeyMap();
+
+    /*  Sets the 'id' of the 'key' (replaces the ID if the key is in the map already) */
+    void Set(std::string_view key, uint8_t id);
+
+    /*  Gets the ID of the 'key' (0 if there is no such key) */
+    uint8_t Find(std::string_view key) const;
+
+    /*  Removes all the keys, keeping the memory */
+    void Clear();
+
+    size_t Size() const     { return m_entries.size(); }
+
+    bool Empty() const      { return m_entries.empty(); }
+
+    /*  Entries in the insertion order */
+    std::vector<Entry>::const_iterator begin() const    { return m_entries.begin(); }
+
+    std::vector<Entry>::const_iterator end() const      { return m_entries.end(); }
+
+private:
+    /*  Finds the slot of the 'key' or the free slot it should take */
+    size_t Probe(std::string_view key, uint64_t hash) const;
+
+    /*  Doubles the table */
+    void Grow();
+
+    static uint32_t TagOf(uint64_t hash)    { return static_cast<uint32_t>(hash >> 32) | 1; }   // 0 - free slot
+
+    size_t HomeSlot(uint64_t hash) const    { return static_cast<size_t>(hash) & m_mask; }
+
+    struct Slot
+    {
+        uint32_t tag = 0;
+        uint32_t entry = 0;
+    };
+
+    std::vector<Slot>  m_table;
+    std::vector<Entry> m_entries;
+    size_t             m_mask;
+};
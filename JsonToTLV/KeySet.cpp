@@ -0,0 +1,145 @@
+#include "KeySet.h"
+#include "Arena.h"
+#include "FlatJsonLexer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <unordered_set>
+
+
+const size_t KeySet::s_reservedIds = 64;
+const size_t KeySet::s_maxKeys = UINT8_MAX - KeySet::s_reservedIds;
+
+namespace
+{
+
+const uint64_t s_maxPilot = 1 << 20;
+
+/*  Mixes the bits of the pilot (splitmix64 finalizer) - the neighbour pilots give unrelated slots */
+uint64_t Mix(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+}   // namespace
+
+
+/*  Builds the set of the 'keys' in their order */
+bool KeySet::Build(const std::vector<std::string>& keys)
+{
+    m_slots.clear();
+    m_pilots.clear();
+    m_names.clear();
+    if (keys.size() > s_maxKeys || std::unordered_set<std::string>(keys.begin(), keys.end()).size() != keys.size()) {
+        return false;
+    }
+    if (keys.empty()) {
+        return true;
+    }
+
+    m_slots.resize(keys.size());
+    m_pilots.assign((keys.size() + 1) / 2, 0);              // ~2 keys per bucket - the pilots are found in a few tries
+    std::vector<std::vector<size_t>> buckets(m_pilots.size());
+    std::vector<uint64_t> hashes(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        hashes[i] = KeyHash::Hash(keys[i]);
+        buckets[BucketOf(hashes[i])].push_back(i);
+    }
+    std::vector<size_t> order(buckets.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&buckets](size_t a, size_t b) { return buckets[a].size() > buckets[b].size(); });
+
+    std::vector<bool> taken(keys.size(), false);
+    std::vector<size_t> slots;
+    for (size_t bucket : order)
+    {
+        uint64_t pilot = 0;
+        for (; pilot < s_maxPilot; ++pilot)
+        {
+            uint64_t mixed = Mix(pilot);
+            slots.clear();
+            for (size_t key : buckets[bucket])
+            {
+                size_t slot = SlotOf(hashes[key], mixed);
+                if (taken[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+                    break;
+                }
+                slots.push_back(slot);
+            }
+            if (slots.size() == buckets[bucket].size()) {
+                break;
+            }
+        }
+        if (pilot == s_maxPilot)
+        {
+            m_slots.clear();
+            m_pilots.clear();
+            return false;
+        }
+        m_pilots[bucket] = Mix(pilot);
+        for (size_t i = 0; i < slots.size(); ++i)
+        {
+            size_t key = buckets[bucket][i];
+            taken[slots[i]] = true;
+            m_slots[slots[i]].key = keys[key];
+            m_slots[slots[i]].id = static_cast<uint8_t>(key + 1);
+        }
+    }
+    m_names = keys;
+    return true;
+}
+
+/*  Reads the keys from the 'path' - one per line, empty lines are skipped */
+bool KeySet::Load(const std::string& path, std::vector<std::string>& keys)
+{
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+    keys.clear();
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty()) {
+            keys.push_back(line);
+        }
+    }
+    return !in.bad();
+}
+
+/*  Collects the keys of the flat JSON objects among the first 'lines' lines of the 'path' */
+bool KeySet::Sample(const std::string& path, size_t lines, std::vector<std::string>& keys)
+{
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+    keys.clear();
+    std::unordered_set<std::string> seen;
+    Arena arena;
+    std::string line;
+    for (size_t i = 0; i < lines && keys.size() < s_maxKeys && std::getline(in, line); ++i)
+    {
+        Arena::Scope scope(arena);
+        FlatJsonLexer::Fields fields;
+        if (!FlatJsonLexer::Parse(line, fields)) {
+            continue;                                       // Keys of the other lines are left for the fallback
+        }
+        for (const auto& field : fields)
+        {
+            std::string key(field.key);
+            if (keys.size() < s_maxKeys && seen.insert(key).second) {
+                keys.push_back(std::move(key));
+            }
+        }
+    }
+    return !in.bad();
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "KeyHash.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+/*  Fixed set of the JSON keys known in advance (from a key list file or a sample of the input), with a minimal perfect hash over
+ *  them: every key has its own slot of the table of exactly Size() slots, so Find() is one hash and one compare, with no probing.
+ *
+ *  The keys are split to the buckets by the hash;  each bucket has a 'pilot' (found by Build(), the biggest buckets first) which
+ *  is mixed into the hash to place all the bucket's keys to the free slots. Known keys take the fixed IDs - their positions in
+ *  the list (1, 2, 3...), the others are up to the caller (see JsonToTlvConverter::SetKeySet()). Key IDs are 1-byte values, so
+ *  the set takes up to s_maxKeys keys - s_reservedIds IDs are always left for the keys out of the set.
+ */
+class KeySet
+{
+public:
+    static const size_t s_reservedIds;
+    static const size_t s_maxKeys;
+
+public:
+    /*  Builds the set of the 'keys' in their order. Returns false if they repeat or there are more than s_maxKeys of them */
+    bool Build(const std::vector<std::string>& keys);
+
+    /*  Gets the number of the keys */
+    size_t Size() const                 { return m_names.size(); }
+
+    /*  Gets the ID of the 'key' (0 if the key is not in the set) */
+    uint8_t Find(std::string_view key) const
+    {
+        if (m_slots.empty()) {
+            return 0;
+        }
+        uint64_t hash = KeyHash::Hash(key);
+        const Slot& slot = m_slots[SlotOf(hash, m_pilots[BucketOf(hash)])];
+        return slot.key == key ? slot.id : 0;
+    }
+
+    /*  Gets the key of the 'id' (1 ... Size()) */
+    const std::string& Key(uint8_t id) const    { return m_names[id - 1]; }
+
+    /*  Reads the keys from the 'path' - one per line, empty lines are skipped */
+    static bool Load(const std::string& path, std::vector<std::string>& keys);
+
+    /*  Collects the keys of the flat JSON objects among the first 'lines' lines of the 'path' (up to s_maxKeys, in the order they
+     *  are met) */
+    static bool Sample(const std::string& path, size_t lines, std::vector<std::string>& keys);
+
+private:
+    struct Slot
+    {
+        std::string key;
+        uint8_t     id = 0;
+    };
+
+    size_t BucketOf(uint64_t hash) const                { return (hash >> 32) % m_pilots.size(); }
+
+    size_t SlotOf(uint64_t hash, uint64_t mixedPilot) const { return (hash ^ mixedPilot) % m_slots.size(); }
+
+    std::vector<Slot>        m_slots;
+    std::vector<uint64_t>    m_pilots;      // By bucket, mixed already
+    std::vector<std::string> m_names;       // By ID - 1
+};
@@ -0,0 +1,208 @@
+#include "Options.h"
+
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+
+
+namespace
+{
+
+void PrintUsage()
+{
+    std::cout << "Usage: JsonToTLV [--threads N] [--stats] [--trace FILE] [--rejects FILE] [--flush-threshold BYTES]\n"
+                 "                 [--io-uring] [--output-dir DIR] [--shard-levels N] [--shard-by number|hash]\n"
+                 "                 [--dict-format tlv|indexed] [--keys FILE | --keys-sample LINES]\n"
+                 "                 [--dedupe-dicts | --segments]\n"
+                 "                 /path/to/json/file.txt|/path/to/dir...\n"
+                 "       JsonToTLV --serve SOCKET [--threads N] [--flush-threshold BYTES] [--io-uring]\n"
+                 "                 [--output-dir DIR] [--shard-levels N] [--shard-by number|hash]\n"
+                 "                 [--dict-format tlv|indexed] [--keys FILE]" << std::endl;
+}
+
+bool ParseSize(const char* str, size_t& value)
+{
+    char* end = nullptr;
+    unsigned long long parsed = strtoull(str, &end, 10);
+    if (*str < '0' || *str > '9' || *end != '\0') {
+        return false;
+    }
+    value = static_cast<size_t>(parsed);
+    return true;
+}
+
+}   // namespace
+
+
+/*  Fills the 'options' from the command line. Prints the usage and returns false if the command line is wrong */
+bool ParseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--threads") == 0)
+        {
+            if (++i == argc || !ParseSize(argv[i], options.threads)) {
+                std::cout << "Expected the number of threads after --threads" << std::endl;
+                PrintUsage();
+                return false;
+            }
+        }
+        else if (strcmp(argv[i], "--stats") == 0) {
+            options.stats = true;
+        }
+        else if (strcmp(argv[i], "--trace") == 0)
+        {
+            if (++i == argc || argv[i][0] == '\0') {
+                std::cout << "Expected the file after --trace" << std::endl;
+                PrintUsage();
+                return false;
+            }
+#ifdef JSONTOTLV_TRACE
+            options.traceFile = argv[i];
+#else
+            std::cout << "Tracing is not built in (see JSONTOTLV_TRACE CMake option), --trace is ignored" << std::endl;
+#endif
+        }
+        else if (strcmp(argv[i], "--rejects") == 0)
+        {
+            if (++i == argc || argv[i][0] == '\0') {
+                std::cout << "Expected the file after --rejects" << std::endl;
+                PrintUsage();
+                return false;
+            }
+            options.rejectsFile = argv[i];
+        }
+        else if (strcmp(argv[i], "--flush-threshold") == 0)
+        {
+            if (++i == argc || !ParseSize(argv[i], options.flushThreshold)) {
+                std::cout << "Expected the number of bytes after --flush-threshold" << std::endl;
+                PrintUsage();
+                return false;
+            }
+        }
+        else if (strcmp(argv[i], "--io-uring") == 0) {
+            options.ioUring = true;
+        }
+        else if (strcmp(argv[i], "--output-dir") == 0)
+        {
+            if (++i == argc || argv[i][0] == '\0') {
+                std::cout << "Expected the directory after --output-dir" << std::endl;
+                PrintUsage();
+                return false;
+            }
+            options.outputDir = argv[i];
+        }
+        else if (strcmp(argv[i], "--shard-levels") == 0)
+        {
+            if (++i == argc || !ParseSize(argv[i], options.shardLevels) || options.shardLevels > OutputLayout::s_maxLevels) {
+                std::cout << "Expected the number of levels (0 - " << OutputLayout::s_maxLevels << ") after --shard-levels"
+                          << std::endl;
+                PrintUsage();
+                return false;
+            }
+        }
+        else if (strcmp(argv[i], "--shard-by") == 0)
+        {
+            ++i;
+            if (i < argc && strcmp(argv[i], "number") == 0) {
+                options.sharding = OutputLayout::Sharding::Number;
+            }
+            else if (i < argc && strcmp(argv[i], "hash") == 0) {
+                options.sharding = OutputLayout::Sharding::Hash;
+            }
+            else {
+                std::cout << "Expected 'number' or 'hash' after --shard-by" << std::endl;
+                PrintUsage();
+                return false;
+            }
+        }
+        else if (strcmp(argv[i], "--dict-format") == 0)
+        {
+            ++i;
+            if (i < argc && strcmp(argv[i], "tlv") == 0) {
+                options.dictFormat = JsonToTlvConverter::DictFormat::TLV;
+            }
+            else if (i < argc && strcmp(argv[i], "indexed") == 0) {
+                options.dictFormat = JsonToTlvConverter::DictFormat::Indexed;
+            }
+            else {
+                std::cout << "Expected 'tlv' or 'indexed' after --dict-format" << std::endl;
+                PrintUsage();
+                return false;
+            }
+        }
+        else if (strcmp(argv[i], "--keys") == 0)
+        {
+            if (++i == argc || argv[i][0] == '\0') {
+                std::cout << "Expected the file after --keys" << std::endl;
+                PrintUsage();
+                return false;
+            }
+            options.keysFile = argv[i];
+        }
+        else if (strcmp(argv[i], "--keys-sample") == 0)
+        {
+            if (++i == argc || !ParseSize(argv[i], options.keysSample) || options.keysSample == 0) {
+                std::cout << "Expected the number of lines after --keys-sample" << std::endl;
+                PrintUsage();
+                return false;
+            }
+        }
+        else if (strcmp(argv[i], "--serve") == 0)
+        {
+            if (++i == argc || argv[i][0] == '\0') {
+                std::cout << "Expected the socket path after --serve" << std::endl;
+                PrintUsage();
+                return false;
+            }
+            options.serveSocket = argv[i];
+        }
+        else if (strcmp(argv[i], "--dedupe-dicts") == 0) {
+            options.dedupeDicts = true;
+        }
+        else if (strcmp(argv[i], "--segments") == 0) {
+            options.segments = true;
+        }
+        else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            std::cout << "Unknown option: " << argv[i] << std::endl;
+            PrintUsage();
+            return false;
+        }
+        else {
+            options.inputs.push_back(argv[i]);
+        }
+    }
+    if (!options.keysFile.empty() && options.keysSample) {
+        std::cout << "--keys and --keys-sample can't be used together" << std::endl;
+        PrintUsage();
+        return false;
+    }
+    if (options.dedupeDicts && options.segments) {
+        std::cout << "--dedupe-dicts and --segments can't be used together" << std::endl;
+        PrintUsage();
+        return false;
+    }
+    if (options.segments && (options.flushThreshold || options.ioUring || options.shardLevels)) {
+        std::cout << "--segments can't be used with --flush-threshold, --io-uring and --shard-levels" << std::endl;
+        PrintUsage();
+        return false;
+    }
+    if (!options.serveSocket.empty())
+    {
+        if (!options.inputs.empty() || options.keysSample || options.segments || options.dedupeDicts || options.stats ||
+            !options.rejectsFile.empty() || !options.traceFile.empty())
+        {
+            std::cout << "--serve takes no inputs, --keys-sample, --segments, --dedupe-dicts, --stats, --rejects and --trace"
+                      << std::endl;
+            PrintUsage();
+            return false;
+        }
+        return true;
+    }
+    if (options.inputs.empty()) {
+        std::cout << "Expected the name of the file with valid JSON to convert" << std::endl;
+        PrintUsage();
+        return false;
+    }
+    return true;
+}
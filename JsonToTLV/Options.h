@@ -0,0 +1,62 @@
+#pragma once
+#include "JsonToTlvConverter.h"
+#include "OutputLayout.h"
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+
+/*  Command line of the convertor:
+ *
+ *  JsonToTLV [--threads N] [--stats] [--trace FILE] [--rejects FILE] [--flush-threshold BYTES] [--io-uring]
+ *            [--output-dir DIR] [--shard-levels N] [--shard-by number|hash] [--dict-format tlv|indexed]
+ *            [--keys FILE | --keys-sample LINES] [--dedupe-dicts | --segments]
+ *            /path/to/json/file.txt|/path/to/dir...
+ *  JsonToTLV --serve SOCKET [--threads N] [--flush-threshold BYTES] [--io-uring] [--output-dir DIR] [--shard-levels N]
+ *            [--shard-by number|hash] [--dict-format tlv|indexed] [--keys FILE]
+ *
+ *  Inputs are the files with JSON lines, or directories of such files (see BatchConverter).
+ *  '--threads'             - number of the converting threads (the daemon's connections served at once), 0 (default) - as many
+ *                            as the hardware has
+ *  '--stats'               - prints the phase times, bytes in/out, records/s, record size and Tag histograms (ConversionStats)
+ *  '--trace'               - writes the timeline of the run to the FILE in Chrome trace format (JSONTOTLV_TRACE builds only)
+ *  '--rejects'             - the lines failed to convert are put to the FILE (with their numbers and reasons) instead of
+ *                            stopping the conversion
+ *  '--flush-threshold'     - records are streamed to their files every BYTES encoded instead of being kept in memory whole
+ *  '--io-uring'            - the files are created with io_uring, many of them in flight at once (see UringOutputWriter)
+ *  '--output-dir'          - directory the files go to (current one by default), for the daemon - of the 'F' requests not
+ *                            naming their own
+ *  '--shard-levels'        - the files are spread over N levels of subdirectories (see OutputLayout), 0 (default) - flat
+ *  '--shard-by'            - consecutive lines share the subdirectory ('number', default) or spread evenly ('hash')
+ *  '--dict-format'         - dictionaries are TLV ('tlv', default) or sorted tables looked up in place ('indexed', TLVDictionary)
+ *  '--keys'                - keys listed in the FILE (one per line) take the fixed IDs - their positions in the list (see KeySet)
+ *  '--keys-sample'         - the same for the keys found in the first LINES lines of the first input
+ *  '--dedupe-dicts'        - each distinct dictionary is written once, records reference it in 'dict_index' (DictionaryStore)
+ *  '--segments'            - unordered output: each thread appends its records and dictionaries to its own 'segment_W' file,
+ *                            the 'manifest' maps the line ranges to them (see BatchConverter, SegmentWriter). There are no
+ *                            files per line, so '--flush-threshold', '--io-uring' and '--shard-levels' can't go with it
+ *  '--serve'               - runs as the daemon converting the requests coming to the Unix domain SOCKET (see Daemon)
+ *_____________________________________________________________________________________________________________________________*/
+struct Options
+{
+    std::vector<std::string> inputs;
+    size_t      threads = 0;
+    bool        stats = false;
+    std::string traceFile;
+    std::string rejectsFile;
+    size_t      flushThreshold = 0;         // 0 - records are dumped at once
+    bool        ioUring = false;
+    std::string outputDir;
+    size_t      shardLevels = 0;
+    OutputLayout::Sharding sharding = OutputLayout::Sharding::Number;
+    JsonToTlvConverter::DictFormat dictFormat = JsonToTlvConverter::DictFormat::TLV;
+    std::string keysFile;
+    size_t      keysSample = 0;
+    bool        dedupeDicts = false;
+    bool        segments = false;
+    std::string serveSocket;                // Daemon mode - no inputs
+};
+
+/*  Fills the 'options' from the command line. Prints the usage and returns false if the command line is wrong */
+bool ParseOptions(int argc, char** argv, Options& options);
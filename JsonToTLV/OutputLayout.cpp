@@ -0,0 +1,80 @@
+#include "OutputLayout.h"
+
+#include <filesystem>
+#include <iostream>
+#include <system_error>
+
+
+const uint64_t OutputLayout::s_linesPerShard = 1024;
+const size_t   OutputLayout::s_maxLevels = 4;
+
+namespace
+{
+
+/*  Mixes the bits of the line number (splitmix64 finalizer) - the neighbour lines get unrelated shards */
+uint64_t Mix(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+}   // namespace
+
+
+OutputLayout::OutputLayout(std::string directory, size_t levels, Sharding sharding)
+    : m_directory(std::move(directory))
+    , m_levels(levels < s_maxLevels ? levels : s_maxLevels)
+    , m_sharding(sharding)
+{
+    if (!m_directory.empty() && m_directory.back() != '/') {
+        m_directory += '/';
+    }
+}
+
+/*  Gets the path of the 'name'_'number' file, creating its directories if needed */
+std::string OutputLayout::Path(const std::string& name, uint64_t number)
+{
+    static const char s_hex[] = "0123456789abcdef";
+    std::string path = m_directory;
+
+    if (m_levels)
+    {
+        uint64_t shard = m_sharding == Sharding::Hash ? Mix(number) : number / s_linesPerShard;
+        for (size_t level = m_levels; level > 0; --level)
+        {
+            // The most significant level goes first. Numbered shards beyond 256^levels widen the top level's name instead of
+            // wrapping around - so no leaf directory is filled twice
+            uint64_t bits = shard >> (8 * (level - 1));
+            uint64_t byte = level == m_levels && m_sharding == Sharding::Number ? bits : bits & 0xFF;
+            size_t digits = 2;
+            while (digits < 16 && (byte >> (4 * digits))) {
+                ++digits;
+            }
+            for (size_t digit = digits; digit > 0; --digit) {
+                path += s_hex[(byte >> (4 * (digit - 1))) & 0x0F];
+            }
+            path += '/';
+        }
+    }
+    if (!path.empty() && !MakeDirectory(path)) {
+        return std::string();
+    }
+    return path + name + '_' + std::to_string(number);
+}
+
+/*  Creates the 'directory' with its parents unless it's known to exist */
+bool OutputLayout::MakeDirectory(const std::string& directory)
+{
+    if (m_created.count(directory)) {
+        return true;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        std::cout << "Unable to create the output directory: " << directory << " (" << error.message() << ")" << std::endl;
+        return false;
+    }
+    m_created.insert(directory);
+    return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_set>
+
+
+/*  Names the output files 'name_N' (record_N, dict_N...) and places them into the output directory. With millions of lines the
+ *  flat directory becomes slow to create the files in (and to list or back up), so the files may be spread over the 'levels'
+ *  of subdirectories, 256 entries each:  out/ab/cd/record_N.
+ *
+ *  Sharding::Number puts each s_linesPerShard consecutive lines into one leaf directory (so it's filled and left for good),
+ *  Sharding::Hash spreads the lines evenly over all the leaves. Either way the record and dictionary of a line land together.
+ *  Past 256^levels * s_linesPerShard lines the numbered shards don't wrap around:  the top level gets more than 256 entries
+ *  (out/100/00/...), so a leaf still never holds more than its lines. Directories are created on the first use and remembered,
+ *  so a path costs no extra syscalls afterwards.
+ */
+class OutputLayout
+{
+public:
+    enum class Sharding { Number, Hash };
+
+    static const uint64_t s_linesPerShard;
+    static const size_t   s_maxLevels;
+
+public:
+    /*  'directory' - where the files go (empty - current directory), 'levels' - depth of the subdirectories (0 - flat) */
+    explicit OutputLayout(std::string directory = std::string(), size_t levels = 0, Sharding sharding = Sharding::Number);
+
+    /*  Gets the path of the 'name'_'number' file, creating its directories if needed. Returns empty string if they can't be
+     *  created */
+    std::string Path(const std::string& name, uint64_t number);
+
+private:
+    /*  Creates the 'directory' with its parents unless it's known to exist */
+    bool MakeDirectory(const std::string& directory);
+
+    std::string                     m_directory;
+    size_t                          m_levels;
+    Sharding                        m_sharding;
+    std::unordered_set<std::string> m_created;
+};
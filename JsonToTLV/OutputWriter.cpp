@@ -0,0 +1,57 @@
+#include "OutputWriter.h"
+#include "UringOutputWriter.h"
+
+#include <fstream>
+#include <iostream>
+
+
+const size_t OutputWriter::s_defaultSlots = 64;
+
+namespace
+{
+
+class SyncOutputWriter : public OutputWriter
+{
+public:
+    bool Write(const std::string& filePath, const uint8_t* data, size_t size) override
+    {
+        std::ofstream out(filePath, std::ios::binary | std::ios::out);
+
+        if (!out.is_open()) {
+            std::cout << "Unable to open the file for record: " << filePath << std::endl;
+            m_failed = true;
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(data), size);
+        out.close();
+        m_failed |= out.fail();
+        return !out.fail();
+    }
+
+    bool Finish() override
+    {
+        bool ok = !m_failed;
+        m_failed = false;
+        return ok;
+    }
+
+private:
+    bool m_failed = false;
+};
+
+}   // namespace
+
+
+/*  Creates the io_uring writer with 'slots' files in flight if it's asked and the kernel supports it, synchronous otherwise */
+std::unique_ptr<OutputWriter> OutputWriter::Create(bool ioUring, size_t slots)
+{
+    if (ioUring)
+    {
+        std::unique_ptr<OutputWriter> writer = UringOutputWriter::Create(slots);
+        if (writer) {
+            return writer;
+        }
+        std::cout << "io_uring is not available, the files are written synchronously" << std::endl;
+    }
+    return std::unique_ptr<OutputWriter>(new SyncOutputWriter);
+}
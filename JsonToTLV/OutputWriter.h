@@ -0,0 +1,31 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+
+
+/*  Backend creating the output files (record_N, dict_N...). Each Write() makes a whole file of the given bytes; the writer may
+ *  keep it in flight and report the failures only by Finish(). The data is copied, so the caller's buffer is free to be reused
+ *  at once. Files in flight are written in no particular order - the same file must not be written twice before Finish().
+ *
+ *  Synchronous writer does open/write/close right away. The io_uring one (Linux) queues the three of them as a linked chain and
+ *  keeps a fixed number of the files in flight - so a batch of the small files costs one syscall instead of three per file.
+ */
+class OutputWriter
+{
+public:
+    static const size_t s_defaultSlots;
+
+public:
+    virtual ~OutputWriter() = default;
+
+    /*  Creates (truncates) the file 'filePath' with the 'size' bytes of 'data'. Returns false if the failure is known at once */
+    virtual bool Write(const std::string& filePath, const uint8_t* data, size_t size) = 0;
+
+    /*  Waits for all the files to be written. Returns false if any of them has failed since the last Finish() */
+    virtual bool Finish() = 0;
+
+    /*  Creates the io_uring writer with 'slots' files in flight if it's asked and the kernel supports it, synchronous otherwise */
+    static std::unique_ptr<OutputWriter> Create(bool ioUring, size_t slots = s_defaultSlots);
+};
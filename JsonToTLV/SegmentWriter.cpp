@@ -0,0 +1,49 @@
+#include "SegmentWriter.h"
+
+#include <iostream>
+
+
+/*  Creates (truncates) the segment file 'path' */
+bool SegmentWriter::Open(const std::string& path)
+{
+    m_path = path;
+    m_size = 0;
+    m_file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!m_file.is_open()) {
+        std::cout << "Unable to create the segment file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/*  Appends the first 'lines' lines of the 'batch' as a chunk. Gives the chunk's 'offset' in the segment and its 'size' */
+bool SegmentWriter::Append(const JsonToTlvConverter::Batch& batch, size_t lines, uint64_t& offset, uint64_t& size)
+{
+    size_t count = 2 * lines + 1;
+    m_offsets.resize(count * sizeof(uint64_t));
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint64_t val = batch.offsets[i];
+        for (size_t b = 0; b < sizeof(uint64_t); ++b) {
+            m_offsets[i * sizeof(uint64_t) + b] = static_cast<uint8_t>(val >> (8 * b));
+        }
+    }
+    size_t dataSize = batch.offsets[count - 1];
+
+    m_file.write(reinterpret_cast<const char*>(m_offsets.data()), m_offsets.size());
+    m_file.write(reinterpret_cast<const char*>(batch.data.data()), dataSize);
+    offset = m_size;
+    size = m_offsets.size() + dataSize;
+    m_size += size;
+    return !m_file.fail();
+}
+
+/*  Flushes and closes the segment. Returns false if any write has failed */
+bool SegmentWriter::Close()
+{
+    if (!m_file.is_open()) {
+        return true;
+    }
+    m_file.close();
+    return !m_file.fail();
+}
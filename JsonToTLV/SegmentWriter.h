@@ -0,0 +1,48 @@
+#pragma once
+#include "JsonToTlvConverter.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+/*  Segment file of one worker for the unordered output (Options::segments). Every converted range of the lines is appended to
+ *  the segment as one chunk - the JsonToTlvConverter::Batch of the range as is, headed by its offsets:
+ *
+ *      offsets: u64 x (2 * lines + 1) | records and dictionaries
+ *
+ *  Offsets are little endian and count from the start of the data:  record of the i-th line of the chunk takes the bytes
+ *  [offsets[2i], offsets[2i+1]), its dictionary - [offsets[2i+1], offsets[2i+2]). A rejected line has both of them empty.
+ *  Where the chunk is and which lines it has is told by the manifest (see BatchConverter).
+ *
+ *  Only its worker writes the segment, so the appends need no locks and take no turns with the other workers.
+ */
+class SegmentWriter
+{
+public:
+    SegmentWriter() = default;
+
+    SegmentWriter(const SegmentWriter&) = delete;
+
+    SegmentWriter& operator=(const SegmentWriter&) = delete;
+
+    /*  Creates (truncates) the segment file 'path' */
+    bool Open(const std::string& path);
+
+    /*  Appends the first 'lines' lines of the 'batch' as a chunk. Gives the chunk's 'offset' in the segment and its 'size' */
+    bool Append(const JsonToTlvConverter::Batch& batch, size_t lines, uint64_t& offset, uint64_t& size);
+
+    /*  Flushes and closes the segment. Returns false if any write has failed */
+    bool Close();
+
+    /*  Gets the path of the segment file */
+    const std::string& Path() const     { return m_path; }
+
+private:
+    std::string          m_path;
+    std::ofstream        m_file;
+    uint64_t             m_size = 0;        // Bytes appended so far
+    std::vector<uint8_t> m_offsets;         // Encoded offsets of the chunk - kept for its capacity
+};
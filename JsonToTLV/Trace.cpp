@@ -0,0 +1,132 @@
+#include "Trace.h"
+
+#ifdef JSONTOTLV_TRACE
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace
+{
+
+struct Event
+{
+    const char* name;
+    uint64_t    start;
+    uint64_t    end;
+};
+
+/*  Ring of the latest spans of one thread. Owned by the registry - so they outlive the thread */
+struct Buffer
+{
+    size_t             thread;
+    size_t             capacity;
+    uint64_t           recorded = 0;        // All the spans of the thread - the ones beyond the capacity are overwritten
+    std::vector<Event> events;              // Grows up to the capacity, then the span 'recorded % capacity' is the oldest
+};
+
+struct Registry
+{
+    std::mutex                            mutex;
+    std::vector<std::unique_ptr<Buffer>>  buffers;
+    size_t                                capacity = Trace::s_defaultCapacity;
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+Registry& GetRegistry()
+{
+    static Registry registry;
+    return registry;
+}
+
+thread_local Buffer* t_buffer = nullptr;
+
+Buffer& ThreadBuffer()
+{
+    if (!t_buffer)
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.buffers.emplace_back(new Buffer);
+        t_buffer = registry.buffers.back().get();
+        t_buffer->thread = registry.buffers.size();
+        t_buffer->capacity = registry.capacity;
+        t_buffer->events.reserve(std::min<size_t>(registry.capacity, 64 * 1024));
+    }
+    return *t_buffer;
+}
+
+}   // namespace
+
+
+/*  Gets the nanoseconds since the process has started tracing */
+uint64_t Trace::Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - GetRegistry().epoch).count();
+}
+
+/*  Appends the span to the calling thread's buffer, dropping its oldest span if the buffer is full */
+void Trace::Record(const char* name, uint64_t start, uint64_t end)
+{
+    Buffer& buffer = ThreadBuffer();
+    if (buffer.events.size() < buffer.capacity) {
+        buffer.events.push_back({ name, start, end });
+    }
+    else {
+        buffer.events[buffer.recorded % buffer.capacity] = { name, start, end };
+    }
+    ++buffer.recorded;
+}
+
+/*  Sets the number of spans the buffers of the threads starting to record from now on keep */
+void Trace::SetCapacity(size_t spans)
+{
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.capacity = std::max<size_t>(spans, 1);
+}
+
+/*  Writes all the spans recorded as Chrome trace JSON ("X" - complete events, times in microseconds), the number of the dropped
+ *  ones goes to its "otherData" */
+bool Trace::Export(const std::string& filePath)
+{
+    std::ofstream out(filePath, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cout << "Unable to open the trace file: " << filePath << std::endl;
+        return false;
+    }
+
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    bool first = true;
+    uint64_t dropped = 0;
+
+    out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+    for (const auto& buffer : registry.buffers)
+    {
+        size_t count = buffer->events.size();
+        size_t oldest = buffer->recorded > count ? buffer->recorded % count : 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Event& event = buffer->events[(oldest + i) % count];
+            out << (first ? "\n" : ",\n") << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread
+                << ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+            first = false;
+        }
+        dropped += buffer->recorded - count;
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":" << dropped << "}}\n";
+    if (dropped) {
+        std::cout << "Trace buffers were full, " << dropped << " oldest spans dropped" << std::endl;
+    }
+    out.close();
+    return !out.fail();
+}
+
+#endif
@@ -0,0 +1,67 @@
+#pragma once
+
+/*  Optional timeline of the conversion in Chrome trace format (chrome://tracing, Perfetto). Built only with the CMake option
+ *  JSONTOTLV_TRACE - otherwise TRACE_SPAN() compiles to nothing and there is no trace code at all.
+ *
+ *  TRACE_SPAN("name") records the span from its line to the end of the scope. Every thread appends its spans to its own buffer
+ *  (no locks or atomics on the way - the mutex is taken just once, when the thread records its first span), and Export() writes
+ *  them all when the threads are done. The name must be a string literal - only the pointer is kept.
+ *
+ *  The buffer is a ring of a fixed number of spans, so tracing a long run takes bounded memory:  the thread keeps its latest
+ *  spans, the older ones are dropped - and counted, Export() tells how many of them are missing.
+ */
+#ifdef JSONTOTLV_TRACE
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace Trace
+{
+
+/*  Spans kept by one thread by default - 6 MB of them */
+const size_t s_defaultCapacity = 256 * 1024;
+
+/*  Gets the nanoseconds since the process has started tracing */
+uint64_t Now();
+
+/*  Appends the span to the calling thread's buffer, dropping its oldest span if the buffer is full */
+void Record(const char* name, uint64_t start, uint64_t end);
+
+/*  Sets the number of spans the buffers of the threads starting to record from now on keep (s_defaultCapacity by default) */
+void SetCapacity(size_t spans);
+
+/*  Writes all the spans recorded to the 'filePath' as Chrome trace JSON, with the number of the dropped ones. No thread may be
+ *  recording meanwhile */
+bool Export(const std::string& filePath);
+
+class Span
+{
+public:
+    explicit Span(const char* name)
+        : m_name(name)
+        , m_start(Now())
+    {}
+
+    ~Span()                     { Record(m_name, m_start, Now()); }
+
+    Span(const Span&) = delete;
+
+    Span& operator=(const Span&) = delete;
+
+private:
+    const char* m_name;
+    uint64_t    m_start;
+};
+
+}   // namespace Trace
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b)      TRACE_CONCAT_IMPL(a, b)
+#define TRACE_SPAN(name)        Trace::Span TRACE_CONCAT(traceSpan_, __LINE__)(name)
+
+#else
+
+#define TRACE_SPAN(name)        ((void)0)
+
+#endif
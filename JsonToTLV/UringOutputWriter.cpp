@@ -0,0 +1,321 @@
+#include "UringOutputWriter.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+
+
+namespace
+{
+
+enum class Operation : uint64_t { Open, Write, Close };
+
+const unsigned s_chainLength = 3;
+const size_t   s_maxWrite = 0x7FFFF000;         // Kernel doesn't write more at once (MAX_RW_COUNT)
+
+inline uint64_t UserData(uint32_t slot, Operation op)   { return (static_cast<uint64_t>(slot) << 2) | static_cast<uint64_t>(op); }
+
+int SysSetup(unsigned entries, io_uring_params* params)
+{
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int SysEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int SysRegister(int fd, unsigned opcode, void* arg, unsigned count)
+{
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+}   // namespace
+
+
+/*  Mapped rings of the io_uring instance */
+struct UringOutputWriter::Ring
+{
+    int            fd = -1;
+    void*          sqMap = MAP_FAILED;
+    size_t         sqMapSize = 0;
+    void*          cqMap = MAP_FAILED;
+    size_t         cqMapSize = 0;
+    io_uring_sqe*  sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t         sqesSize = 0;
+
+    unsigned*      sqHead = nullptr;
+    unsigned*      sqTail = nullptr;
+    unsigned       sqMask = 0;
+    unsigned*      cqHead = nullptr;
+    unsigned*      cqTail = nullptr;
+    unsigned       cqMask = 0;
+    io_uring_cqe*  cqes = nullptr;
+
+    ~Ring()
+    {
+        if (sqes != MAP_FAILED) {
+            munmap(sqes, sqesSize);
+        }
+        if (cqMap != MAP_FAILED && cqMap != sqMap) {
+            munmap(cqMap, cqMapSize);
+        }
+        if (sqMap != MAP_FAILED) {
+            munmap(sqMap, sqMapSize);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    /*  Gets the 'i'-th free SQE past the tail, zeroed (the caller makes sure there is one) */
+    io_uring_sqe* FreeSqe(unsigned i)
+    {
+        io_uring_sqe* sqe = &sqes[(*sqTail + i) & sqMask];
+        memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    /*  Hands the 'count' filled SQEs to the kernel */
+    void Publish(unsigned count)
+    {
+        __atomic_store_n(sqTail, *sqTail + count, __ATOMIC_RELEASE);
+    }
+};
+
+
+UringOutputWriter::UringOutputWriter(size_t slots)
+    : m_ring(new Ring)
+    , m_slots(slots)
+{
+    m_freeSlots.reserve(slots);
+    for (size_t i = slots; i > 0; --i) {
+        m_freeSlots.push_back(static_cast<uint32_t>(i - 1));
+    }
+}
+
+UringOutputWriter::~UringOutputWriter()
+{
+    if (m_ring->fd >= 0) {
+        Finish();
+    }
+}
+
+/*  Creates the writer with 'slots' files in flight. Returns nullptr if the kernel can't do it */
+std::unique_ptr<OutputWriter> UringOutputWriter::Create(size_t slots)
+{
+    if (slots == 0) {
+        return nullptr;
+    }
+    std::unique_ptr<UringOutputWriter> writer(new UringOutputWriter(slots));
+    if (!writer->Init()) {
+        return nullptr;
+    }
+    return writer;
+}
+
+/*  Sets the ring up. Returns false if the kernel lacks anything needed */
+bool UringOutputWriter::Init()
+{
+    Ring& ring = *m_ring;
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    // All the chains of the slots fit into the SQ at once - so a free slot always has room for its SQEs
+    ring.fd = SysSetup(static_cast<unsigned>(m_slots.size() * s_chainLength), &params);
+    if (ring.fd < 0 || !(params.features & IORING_FEAT_NODROP)) {
+        return false;
+    }
+
+    ring.sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring.cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring.sqMapSize = ring.cqMapSize = std::max(ring.sqMapSize, ring.cqMapSize);
+    }
+    ring.sqMap = mmap(nullptr, ring.sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQ_RING);
+    if (ring.sqMap == MAP_FAILED) {
+        return false;
+    }
+    ring.cqMap = (params.features & IORING_FEAT_SINGLE_MMAP) ? ring.sqMap :
+                 mmap(nullptr, ring.cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_CQ_RING);
+    ring.sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    ring.sqes = static_cast<io_uring_sqe*>(mmap(nullptr, ring.sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                                ring.fd, IORING_OFF_SQES));
+    if (ring.cqMap == MAP_FAILED || ring.sqes == MAP_FAILED) {
+        return false;
+    }
+
+    uint8_t* sq = static_cast<uint8_t*>(ring.sqMap);
+    uint8_t* cq = static_cast<uint8_t*>(ring.cqMap);
+    ring.sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    ring.sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    ring.sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    ring.cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    ring.cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    ring.cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    ring.cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    unsigned* array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    for (unsigned i = 0; i < params.sq_entries; ++i) {
+        array[i] = i;                               // SQEs are used in ring order
+    }
+
+    // Operations the chain needs
+    std::vector<uint8_t> probeMemory(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(probeMemory.data());
+    if (SysRegister(ring.fd, IORING_REGISTER_PROBE, probe, 256) < 0) {
+        return false;
+    }
+    for (uint8_t op : { IORING_OP_OPENAT, IORING_OP_WRITE, IORING_OP_CLOSE })
+    {
+        if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+            return false;
+        }
+    }
+
+    // File table the chains open their files into - one entry per slot
+    io_uring_rsrc_register files;
+    memset(&files, 0, sizeof(files));
+    files.nr = static_cast<uint32_t>(m_slots.size());
+    files.flags = IORING_RSRC_REGISTER_SPARSE;
+    return SysRegister(ring.fd, IORING_REGISTER_FILES2, &files, sizeof(files)) >= 0;
+}
+
+/*  Queues the file to be written. Waits for a free slot if all of them are in flight */
+bool UringOutputWriter::Write(const std::string& filePath, const uint8_t* data, size_t size)
+{
+    if (size > s_maxWrite)
+    {
+        std::cout << "Unable to write the file at once: " << filePath << std::endl;
+        m_failed = true;
+        return false;
+    }
+    while (m_freeSlots.empty())
+    {
+        if (!Enter(1)) {
+            return false;
+        }
+        Reap();
+    }
+    uint32_t index = m_freeSlots.back();
+    m_freeSlots.pop_back();
+
+    Slot& slot = m_slots[index];
+    slot.path = filePath;
+    slot.data.assign(data, data + size);
+    slot.pending = s_chainLength;
+    slot.failed = false;
+
+    io_uring_sqe* openSqe = m_ring->FreeSqe(0);
+    openSqe->opcode = IORING_OP_OPENAT;
+    openSqe->flags = IOSQE_IO_LINK;
+    openSqe->fd = AT_FDCWD;
+    openSqe->addr = reinterpret_cast<uint64_t>(slot.path.c_str());
+    openSqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC;          // No O_CLOEXEC - the direct descriptors refuse it
+    openSqe->len = 0644;
+    openSqe->file_index = index + 1;                // Direct descriptor: slot 'index' of the registered table
+    openSqe->user_data = UserData(index, Operation::Open);
+
+    io_uring_sqe* writeSqe = m_ring->FreeSqe(1);
+    writeSqe->opcode = IORING_OP_WRITE;
+    writeSqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;    // Close the file even if the write fails
+    writeSqe->fd = static_cast<int32_t>(index);
+    writeSqe->addr = reinterpret_cast<uint64_t>(slot.data.data());
+    writeSqe->len = static_cast<uint32_t>(size);
+    writeSqe->off = 0;
+    writeSqe->user_data = UserData(index, Operation::Write);
+
+    io_uring_sqe* closeSqe = m_ring->FreeSqe(2);
+    closeSqe->opcode = IORING_OP_CLOSE;
+    closeSqe->file_index = index + 1;
+    closeSqe->user_data = UserData(index, Operation::Close);
+
+    m_ring->Publish(s_chainLength);
+    m_toSubmit += s_chainLength;
+    return true;
+}
+
+/*  Waits for all the files to be written. Returns false if any of them has failed since the last Finish() */
+bool UringOutputWriter::Finish()
+{
+    while (m_freeSlots.size() != m_slots.size())
+    {
+        if (!Enter(1)) {
+            break;
+        }
+        Reap();
+    }
+    bool ok = !m_failed;
+    m_failed = false;
+    return ok;
+}
+
+/*  Submits the queued chains and waits for 'waitFor' completions */
+bool UringOutputWriter::Enter(unsigned waitFor)
+{
+    while (true)
+    {
+        int ret = SysEnter(m_ring->fd, m_toSubmit, waitFor, IORING_ENTER_GETEVENTS);
+        if (ret >= 0)
+        {
+            m_toSubmit -= static_cast<unsigned>(ret);
+            return true;
+        }
+        if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        {
+            std::cout << "io_uring_enter failed: " << strerror(errno) << std::endl;
+            m_failed = true;
+            return false;
+        }
+        Reap();                                     // Busy or interrupted - free the CQ and try again
+    }
+}
+
+/*  Handles the completed operations, freeing the slots of finished chains */
+void UringOutputWriter::Reap()
+{
+    Ring& ring = *m_ring;
+    unsigned head = *ring.cqHead;
+    unsigned tail = __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; ++head)
+    {
+        const io_uring_cqe& cqe = ring.cqes[head & ring.cqMask];
+        uint32_t index = static_cast<uint32_t>(cqe.user_data >> 2);
+        Slot& slot = m_slots[index];
+
+        bool write = static_cast<Operation>(cqe.user_data & 3) == Operation::Write;
+        if (cqe.res < 0 || (write && static_cast<size_t>(cqe.res) != slot.data.size())) {
+            slot.failed = true;
+        }
+        if (--slot.pending == 0)
+        {
+            if (slot.failed)
+            {
+                std::cout << "Unable to write the file: " << slot.path << std::endl;
+                m_failed = true;
+            }
+            m_freeSlots.push_back(index);
+        }
+    }
+    __atomic_store_n(ring.cqHead, head, __ATOMIC_RELEASE);
+}
+
+#else
+
+/*  No io_uring on this platform */
+std::unique_ptr<OutputWriter> UringOutputWriter::Create(size_t)
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,57 @@
+#pragma once
+#include "OutputWriter.h"
+
+#include <vector>
+
+
+/*  OutputWriter on top of io_uring (raw syscalls - no liburing needed). Every file takes one of the fixed number of slots and is
+ *  queued as the chain  OPENAT (into the slot of the registered file table) -> WRITE (whole data at offset 0) -> CLOSE,  so the
+ *  ring has no regular descriptor to handle at all. Nothing is submitted until the slots run out (or Finish() is called) - then
+ *  the whole batch goes with one io_uring_enter(), which also waits for at least one chain to complete.
+ *
+ *  Requires Linux 5.19+ (sparse registered files, direct OPENAT/CLOSE); Create() returns nullptr where it's not supported.
+ */
+class UringOutputWriter : public OutputWriter
+{
+public:
+    /*  Creates the writer with 'slots' files in flight. Returns nullptr if the kernel can't do it */
+    static std::unique_ptr<OutputWriter> Create(size_t slots);
+
+    ~UringOutputWriter() override;
+
+    UringOutputWriter(const UringOutputWriter&) = delete;
+
+    UringOutputWriter& operator=(const UringOutputWriter&) = delete;
+
+    bool Write(const std::string& filePath, const uint8_t* data, size_t size) override;
+
+    bool Finish() override;
+
+private:
+    struct Ring;
+
+    struct Slot
+    {
+        std::string          path;
+        std::vector<uint8_t> data;
+        unsigned             pending = 0;   // Operations of the chain not completed yet
+        bool                 failed = false;
+    };
+
+    explicit UringOutputWriter(size_t slots);
+
+    /*  Sets the ring up. Returns false if the kernel lacks anything needed */
+    bool Init();
+
+    /*  Submits the queued chains and waits for 'waitFor' completions */
+    bool Enter(unsigned waitFor);
+
+    /*  Handles the completed operations, freeing the slots of finished chains */
+    void Reap();
+
+    std::unique_ptr<Ring> m_ring;
+    std::vector<Slot>     m_slots;
+    std::vector<uint32_t> m_freeSlots;
+    unsigned              m_toSubmit = 0;
+    bool                  m_failed = false;
+};
@@ -1,4 +1,5 @@
 #include <string>
+#include <string_view>
 
 
 /*  Converts one JSON line to appropriate binaries
@@ -7,4 +8,4 @@
  *  'recordFileName'    - filepath the binary record will be generated to
  *  'dictFileName'      - filepath the binary dictionary will be generated to
  *_____________________________________________________________________________________________________________________________*/
-bool ConvertToTLV(const std::string& jsonString, const std::string& recordFileName, const std::string& dictFileName);
\ No newline at end of file
+bool ConvertToTLV(std::string_view jsonString, const std::string& recordFileName, const std::string& dictFileName);
\ No newline at end of file
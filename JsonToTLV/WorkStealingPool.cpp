@@ -0,0 +1,125 @@
+#include "WorkStealingPool.h"
+#include "Trace.h"
+
+#include <thread>
+
+
+namespace
+{
+
+thread_local size_t t_worker = SIZE_MAX;            // Index of the worker the thread is (SIZE_MAX - not a worker)
+
+}   // namespace
+
+
+WorkStealingPool::WorkStealingPool(size_t threads)
+{
+    for (size_t i = 0; i < (threads ? threads : 1); ++i) {
+        m_queues.emplace_back(new Queue);
+    }
+}
+
+/*  Queues the task. Called by a task - to its worker's deque, otherwise to the deques in turn */
+void WorkStealingPool::Push(Task task)
+{
+    size_t index = t_worker < m_queues.size() ? t_worker : m_nextQueue++ % m_queues.size();
+    Queue& queue = *m_queues[index];
+
+    m_pending.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+        m_queued.fetch_add(1, std::memory_order_release);
+    }
+    std::lock_guard<std::mutex> lock(m_idleMutex);         // The sleeper checks m_queued under it - so the wake-up is not lost
+    m_idle.notify_one();
+}
+
+/*  Runs all the tasks, including the ones pushed while running. The calling thread is the worker 0 */
+void WorkStealingPool::Run()
+{
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < m_queues.size(); ++i) {
+        threads.emplace_back(&WorkStealingPool::Work, this, i);
+    }
+    Work(0);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+/*  Worker's loop: own tasks first, then the stolen ones - until no task is left anywhere */
+void WorkStealingPool::Work(size_t worker)
+{
+    size_t previous = t_worker;
+    t_worker = worker;
+
+    Task task;
+    while (Take(worker, task))
+    {
+        task(worker);
+        task = nullptr;
+        if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)    // Its subtasks are counted already
+        {
+            std::lock_guard<std::mutex> lock(m_idleMutex);
+            m_idle.notify_all();
+        }
+    }
+    t_worker = previous;
+}
+
+/*  Gets the next task for the 'worker', sleeping while some running task may push more. Returns false when all are done */
+bool WorkStealingPool::Take(size_t worker, Task& task)
+{
+    if (Pop(worker, task) || Steal(worker, task)) {
+        return true;
+    }
+    TRACE_SPAN("queue wait");
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_idleMutex);
+            m_idle.wait(lock, [this] {
+                return m_queued.load(std::memory_order_acquire) != 0 || m_pending.load(std::memory_order_acquire) == 0;
+            });
+        }
+        if (Pop(worker, task) || Steal(worker, task)) {
+            return true;
+        }
+        if (m_pending.load(std::memory_order_acquire) == 0) {
+            return false;
+        }
+    }
+}
+
+/*  Takes the newest task of the 'worker' */
+bool WorkStealingPool::Pop(size_t worker, Task& task)
+{
+    Queue& queue = *m_queues[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    m_queued.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+/*  Takes the oldest task of some other worker */
+bool WorkStealingPool::Steal(size_t worker, Task& task)
+{
+    for (size_t i = 1; i < m_queues.size(); ++i)
+    {
+        Queue& queue = *m_queues[(worker + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            m_queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+/*  Thread pool where every worker has its own task deque. The worker takes its tasks from the back (the newest one - its data is
+ *  likely still in cache), and when the deque is empty it steals from the front of the others' deques (the oldest - usually the
+ *  biggest pieces of work). So the tasks pushed by a task (e.g. the ranges of a big file being split) spread over the idle
+ *  workers by themselves, without any central queue.
+ *
+ *  Each deque has its own mutex: the tasks here are whole files or megabytes of lines, so the lock is never a bottleneck. The
+ *  worker finding nothing to steal sleeps on the condition variable till a task is pushed or the last one is done - so the idle
+ *  cores stay idle while one long range is being converted.
+ */
+class WorkStealingPool
+{
+public:
+    /*  Task gets the index of the worker running it - to use the per-worker state */
+    using Task = std::function<void(size_t worker)>;
+
+public:
+    explicit WorkStealingPool(size_t threads);
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /*  Gets the number of workers */
+    size_t Threads() const      { return m_queues.size(); }
+
+    /*  Queues the task. Called by a task - to its worker's deque, otherwise to the deques in turn */
+    void Push(Task task);
+
+    /*  Runs all the tasks, including the ones pushed while running. The calling thread is the worker 0 */
+    void Run();
+
+private:
+    struct Queue
+    {
+        std::mutex       mutex;
+        std::deque<Task> tasks;
+    };
+
+    /*  Worker's loop: own tasks first, then the stolen ones - until no task is left anywhere */
+    void Work(size_t worker);
+
+    /*  Gets the next task for the 'worker', sleeping while some running task may push more. Returns false when all are done */
+    bool Take(size_t worker, Task& task);
+
+    /*  Takes the newest task of the 'worker' */
+    bool Pop(size_t worker, Task& task);
+
+    /*  Takes the oldest task of some other worker */
+    bool Steal(size_t worker, Task& task);
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::atomic<size_t>                 m_pending { 0 };    // Tasks queued or running
+    std::atomic<size_t>                 m_queued { 0 };     // Tasks queued only
+    std::mutex                          m_idleMutex;
+    std::condition_variable             m_idle;             // Signaled by Push() and when the last task is done
+    size_t                              m_nextQueue = 0;    // Where the outer Push() goes
+};
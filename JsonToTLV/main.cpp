@@ -1,8 +1,39 @@
-#include <fstream>
+#include "BatchConverter.h"
+#include "Daemon.h"
+#include "Options.h"
+#include "Trace.h"
+
+#include <csignal>
 #include <iostream>
 
-#include "TLVObject.h"
-#include "Utils.h"
+namespace
+{
+
+Daemon* s_daemon = nullptr;
+
+void StopDaemon(int)
+{
+    s_daemon->Stop();
+}
+
+/*  Serves the requests until SIGINT/SIGTERM */
+int Serve(const Options& options)
+{
+    Daemon daemon(options.serveSocket, options);
+    if (!daemon.Listen()) {
+        return -1;
+    }
+    s_daemon = &daemon;
+    std::signal(SIGINT, StopDaemon);
+    std::signal(SIGTERM, StopDaemon);
+    std::cout << "Serving on " << options.serveSocket << std::endl;
+    daemon.Serve();
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    return 0;
+}
+
+}   // namespace
 
 /*  According to the task here  we expect to receive  the /path/to/json/file.txt.  Each JSON new line will be handled separately.
  *  Appropriate 'record_x' and 'dict_x' files will be generated for them,  where 'x' is the line number.   For example, this JSON
@@ -10,34 +41,33 @@
  *  {"key3":11,"key4":true}         will be converted to binaries: 'record_0', 'record_1', 'dict_0', 'dict_1' files.
  *
  *  From example above: 'record_0' will be built from the source like "{1:11,2:true}", and 'dict_0' - from "{key1:1},{key2:2}".
+ *
+ *  Many files (or directories of them) may be given at once - then each of them gets its own output subdirectory, and they all
+ *  are converted in parallel (see BatchConverter). With '--serve' it runs as the daemon converting the requests coming to the
+ *  Unix domain socket (see Daemon).
  *_____________________________________________________________________________________________________________________________*/
 int main(int argc, char** argv)
 {
-    if (argc != 2) {
-        std::cout << "Expected the name of the file with valid JSON to convert" << std::endl;
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
         return -1;
     }
-
-    std::string jsonFileName = argv[1];
-
-    std::ifstream input(jsonFileName, std::ios::in);
-    if (!input.is_open())
-    {
-        std::cout << "Unable to open the input file" << std::endl;
-        return -1;
+    if (!options.serveSocket.empty()) {
+        return Serve(options);
     }
 
-    uint64_t record_number = 0;         // This is to distinguish the records/dictionaries (as much as many lines in JSON)
-    std::string line;
-    while (std::getline(input, line))
-    {
-        std::string recordName = "record_" + std::to_string(record_number);
-        std::string dictName = "dict_" + std::to_string(record_number);
-
-        if (!ConvertToTLV(line, recordName, dictName))
-            break;
-        ++record_number;
+    BatchConverter converter(options);
+    bool ok = converter.Run();
+    if (options.stats) {
+        converter.PrintStats(std::cout);
     }
-    input.close();
-    return 0;
-}
\ No newline at end of file
+#ifdef JSONTOTLV_TRACE
+    if (!options.traceFile.empty()) {
+        Trace::Export(options.traceFile);
+    }
+#endif
+    if (converter.Rejected()) {
+        std::cout << converter.Rejected() << " lines rejected, see " << options.rejectsFile << std::endl;
+    }
+    return ok ? 0 : -1;
+}
@@ -0,0 +1,260 @@
+#include "BulkIntegerCodec.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BULK_INTEGER_CODEC_X86 1
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SSSE3_TARGET
+#else
+#define SSSE3_TARGET __attribute__((target("ssse3")))
+#endif
+#endif
+
+
+namespace
+{
+
+/*  Scalar helpers - the compilers turn these loops to a single 'bswap' + store/load */
+template<class U>
+inline void PutBigEndian(uint8_t* dst, U val)
+{
+    for (size_t i = 0; i < sizeof(U); ++i) {
+        dst[i] = static_cast<uint8_t>(val >> (8 * (sizeof(U) - 1 - i)));
+    }
+}
+
+template<class U>
+inline U GetBigEndian(const uint8_t* src)
+{
+    U val = 0;
+    for (size_t i = 0; i < sizeof(U); ++i) {
+        val = static_cast<U>((val << 8) | src[i]);
+    }
+    return val;
+}
+
+template<class U>
+void EncodeScalar(uint8_t* dst, uint8_t tag, const uint8_t* src, size_t count)
+{
+    for (size_t i = 0; i < count; ++i, src += sizeof(U), dst += 1 + sizeof(U))
+    {
+        U val;
+        memcpy(&val, src, sizeof(U));
+        dst[0] = tag;
+        PutBigEndian(dst + 1, val);
+    }
+}
+
+template<class U>
+bool DecodeScalar(uint8_t* dst, uint8_t tag, const uint8_t* src, size_t count)
+{
+    for (size_t i = 0; i < count; ++i, src += 1 + sizeof(U), dst += sizeof(U))
+    {
+        if (src[0] != tag) {
+            return false;
+        }
+        U val = GetBigEndian<U>(src + 1);
+        memcpy(dst, &val, sizeof(U));
+    }
+    return true;
+}
+
+void EncodeScalar(uint8_t* dst, uint8_t tag, const uint8_t* src, size_t count, size_t width)
+{
+    switch (width) {
+        case 1: EncodeScalar<uint8_t>(dst, tag, src, count);    break;
+        case 2: EncodeScalar<uint16_t>(dst, tag, src, count);   break;
+        case 4: EncodeScalar<uint32_t>(dst, tag, src, count);   break;
+        case 8: EncodeScalar<uint64_t>(dst, tag, src, count);   break;
+    }
+}
+
+bool DecodeScalar(uint8_t* dst, uint8_t tag, const uint8_t* src, size_t count, size_t width)
+{
+    switch (width) {
+        case 1: return DecodeScalar<uint8_t>(dst, tag, src, count);
+        case 2: return DecodeScalar<uint16_t>(dst, tag, src, count);
+        case 4: return DecodeScalar<uint32_t>(dst, tag, src, count);
+        case 8: return DecodeScalar<uint64_t>(dst, tag, src, count);
+    }
+    return false;
+}
+
+#ifdef BULK_INTEGER_CODEC_X86
+
+bool HasSsse3()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    return __builtin_cpu_supports("ssse3");
+#endif
+}
+
+/*  'pshufb' masks for one 16-byte chunk of values of the given width (2, 4 or 8 bytes). The chunk takes 16 / width * (1 + width)
+ *  bytes in TLV form - more than 16, so it is spread over two registers: 'lo' for the first 16 bytes and 'hi' for the rest.
+ *  Mask byte 0x80 gives zero - these are the tag positions (see 'tagLo'/'tagHi', having 0xFF there) */
+struct ShuffleMasks
+{
+    __m128i encodeLo, encodeHi;         // Chunk of values => TLV form
+    __m128i tagLo, tagHi;
+    __m128i decodeLo, decodeHi;         // TLV form => chunk of values
+    __m128i gatherTagsLo, gatherTagsHi; // TLV form => tags in the lanes [0 ... 16 / width)
+    __m128i tagLanes;                   // 0xFF in the lanes [0 ... 16 / width)
+    size_t  perChunk;                   // Values in a chunk
+    size_t  tlvBytes;                   // Bytes the chunk takes in TLV form
+
+    explicit ShuffleMasks(size_t width)
+    {
+        alignas(16) uint8_t encLo[16], encHi[16], tLo[16], tHi[16], decLo[16], decHi[16], gLo[16], gHi[16], lanes[16];
+        perChunk = 16 / width;
+        tlvBytes = perChunk * (1 + width);
+
+        for (size_t j = 0; j < 32; ++j)
+        {
+            size_t item = j / (1 + width);
+            size_t offset = j % (1 + width);
+            uint8_t enc = 0x80, tag = 0x00;
+            if (j < tlvBytes)
+            {
+                enc = offset == 0 ? 0x80 : static_cast<uint8_t>(width * item + width - offset);   // Big endian <= little endian
+                tag = offset == 0 ? 0xFF : 0x00;
+            }
+            (j < 16 ? encLo : encHi)[j % 16] = enc;
+            (j < 16 ? tLo : tHi)[j % 16] = tag;
+        }
+        for (size_t k = 0; k < 16; ++k)
+        {
+            size_t item = k / width;
+            size_t j = item * (1 + width) + 1 + (width - 1 - k % width);                            // Source byte in TLV form
+            decLo[k] = j < 16 ? static_cast<uint8_t>(j) : 0x80;
+            decHi[k] = j < 16 ? 0x80 : static_cast<uint8_t>(j - 16);
+
+            j = k * (1 + width);
+            gLo[k] = (k < perChunk && j < 16) ? static_cast<uint8_t>(j) : 0x80;
+            gHi[k] = (k < perChunk && j >= 16) ? static_cast<uint8_t>(j - 16) : 0x80;
+            lanes[k] = k < perChunk ? 0xFF : 0x00;
+        }
+        encodeLo = _mm_load_si128(reinterpret_cast<const __m128i*>(encLo));
+        encodeHi = _mm_load_si128(reinterpret_cast<const __m128i*>(encHi));
+        tagLo = _mm_load_si128(reinterpret_cast<const __m128i*>(tLo));
+        tagHi = _mm_load_si128(reinterpret_cast<const __m128i*>(tHi));
+        decodeLo = _mm_load_si128(reinterpret_cast<const __m128i*>(decLo));
+        decodeHi = _mm_load_si128(reinterpret_cast<const __m128i*>(decHi));
+        gatherTagsLo = _mm_load_si128(reinterpret_cast<const __m128i*>(gLo));
+        gatherTagsHi = _mm_load_si128(reinterpret_cast<const __m128i*>(gHi));
+        tagLanes = _mm_load_si128(reinterpret_cast<const __m128i*>(lanes));
+    }
+
+    static const ShuffleMasks& ForWidth(size_t width)
+    {
+        static const ShuffleMasks masks2(2), masks4(4), masks8(8);
+        return width == 2 ? masks2 : (width == 4 ? masks4 : masks8);
+    }
+};
+
+/*  Handles the chunks while there are two or more left - the 'hi' store/load of 16 bytes then stays inside the buffer. Returns
+ *  the number of values done */
+SSSE3_TARGET size_t EncodeSsse3(uint8_t* dst, uint8_t tag, const uint8_t* src, size_t count, size_t width)
+{
+    const ShuffleMasks& m = ShuffleMasks::ForWidth(width);
+    const __m128i tags = _mm_set1_epi8(static_cast<char>(tag));
+    const __m128i tagLo = _mm_and_si128(m.tagLo, tags);
+    const __m128i tagHi = _mm_and_si128(m.tagHi, tags);
+    size_t done = 0;
+
+    for (; count - done >= 2 * m.perChunk; done += m.perChunk, src += 16, dst += m.tlvBytes)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_or_si128(_mm_shuffle_epi8(chunk, m.encodeLo), tagLo));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), _mm_or_si128(_mm_shuffle_epi8(chunk, m.encodeHi), tagHi));
+    }
+    return done;
+}
+
+SSSE3_TARGET size_t DecodeSsse3(uint8_t* dst, uint8_t tag, const uint8_t* src, size_t count, size_t width, bool& ok)
+{
+    const ShuffleMasks& m = ShuffleMasks::ForWidth(width);
+    const __m128i expected = _mm_and_si128(m.tagLanes, _mm_set1_epi8(static_cast<char>(tag)));
+    size_t done = 0;
+
+    ok = true;
+    for (; count - done >= 2 * m.perChunk; done += m.perChunk, src += m.tlvBytes, dst += 16)
+    {
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+        __m128i tags = _mm_or_si128(_mm_shuffle_epi8(lo, m.gatherTagsLo), _mm_shuffle_epi8(hi, m.gatherTagsHi));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(tags, expected)) != 0xFFFF)
+        {
+            ok = false;
+            break;
+        }
+        __m128i values = _mm_or_si128(_mm_shuffle_epi8(lo, m.decodeLo), _mm_shuffle_epi8(hi, m.decodeHi));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), values);
+    }
+    return done;
+}
+
+/*  1-byte values just get interleaved with the tags - SSE2 is enough */
+size_t Encode8Sse2(uint8_t* dst, uint8_t tag, const uint8_t* src, size_t count)
+{
+    const __m128i tags = _mm_set1_epi8(static_cast<char>(tag));
+    size_t done = 0;
+
+    for (; count - done >= 16; done += 16, src += 16, dst += 32)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi8(tags, chunk));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), _mm_unpackhi_epi8(tags, chunk));
+    }
+    return done;
+}
+
+#endif  // BULK_INTEGER_CODEC_X86
+
+}   // namespace
+
+
+/*  Writes 'count' values of 'width' bytes from 'src' to 'dst' as TLV with the 'tag' */
+void BulkIntegerCodec::Encode(uint8_t* dst, uint8_t tag, const void* src, size_t count, size_t width)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(src);
+    size_t done = 0;
+
+#ifdef BULK_INTEGER_CODEC_X86
+    static const bool ssse3 = HasSsse3();
+    if (width == 1) {
+        done = Encode8Sse2(dst, tag, bytes, count);
+    }
+    else if (ssse3) {
+        done = EncodeSsse3(dst, tag, bytes, count, width);
+    }
+#endif
+    EncodeScalar(dst + done * (1 + width), tag, bytes + done * width, count - done, width);
+}
+
+/*  Reads 'count' TLV integers of 'width' bytes from 'src' to 'dst'. Returns false if some item has a tag other than 'tag' */
+bool BulkIntegerCodec::Decode(void* dst, uint8_t tag, const uint8_t* src, size_t count, size_t width)
+{
+    uint8_t* bytes = static_cast<uint8_t*>(dst);
+    size_t done = 0;
+
+#ifdef BULK_INTEGER_CODEC_X86
+    static const bool ssse3 = HasSsse3();
+    if (ssse3 && width != 1)
+    {
+        bool ok;
+        done = DecodeSsse3(bytes, tag, src, count, width, ok);
+        if (!ok) {
+            return false;
+        }
+    }
+#endif
+    return DecodeScalar(bytes + done * width, tag, src + done * (1 + width), count - done, width);
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*  Bulk conversion of the integer arrays to/from their TLV form - 'count' items of 'Tag' + 'width'-byte big endian value, exactly
+ *  what the same number of TLVObject::WriteInteger() calls would give.
+ *
+ *  Values are byte-swapped in the SIMD registers:  with SSSE3 (checked at runtime) one 'pshufb' reverses the bytes of every value
+ *  in a 16-byte chunk and spreads them leaving the gaps for the tags, which are ORed in afterwards - so a whole chunk is stored at
+ *  once. 1-byte values only need interleaving with the tags, SSE2 'punpck' does it. Without SIMD each value is swapped with the
+ *  'bswap' instruction the compilers make of the byte-swap builtins.
+ */
+class BulkIntegerCodec
+{
+public:
+    /*  Writes 'count' values of 'width' (1, 2, 4 or 8) bytes from 'src' to 'dst' as TLV with the 'tag'. 'dst' must have the room
+     *  for count * (1 + width) bytes */
+    static void Encode(uint8_t* dst, uint8_t tag, const void* src, size_t count, size_t width);
+
+    /*  Reads 'count' TLV integers of 'width' bytes from 'src' to 'dst'. Returns false if some item has a tag other than 'tag'. 'src'
+     *  must have count * (1 + width) bytes */
+    static bool Decode(void* dst, uint8_t tag, const uint8_t* src, size_t count, size_t width);
+};
@@ -0,0 +1,177 @@
+#include "TLVDictionary.h"
+
+#include <algorithm>
+#include <string.h>
+
+
+namespace
+{
+
+const uint8_t s_magic[4] = { 'T', 'L', 'V', 'D' };
+
+inline void Put16(uint8_t* dst, uint16_t val)
+{
+    dst[0] = static_cast<uint8_t>(val);
+    dst[1] = static_cast<uint8_t>(val >> 8);
+}
+
+inline void Put32(uint8_t* dst, uint32_t val)
+{
+    for (size_t i = 0; i < 4; ++i) {
+        dst[i] = static_cast<uint8_t>(val >> (8 * i));
+    }
+}
+
+inline uint16_t Get16(const uint8_t* src)
+{
+    return static_cast<uint16_t>(src[0] | (src[1] << 8));
+}
+
+inline uint32_t Get32(const uint8_t* src)
+{
+    return static_cast<uint32_t>(src[0]) | (static_cast<uint32_t>(src[1]) << 8) | (static_cast<uint32_t>(src[2]) << 16) |
+           (static_cast<uint32_t>(src[3]) << 24);
+}
+
+/*  Size of the ID table, padded to keep the names block 4-byte aligned */
+inline size_t IdTableSize(size_t maxId)
+{
+    return ((maxId + 1) * 2 + 3) & ~static_cast<size_t>(3);
+}
+
+}   // namespace
+
+
+TLVDictionary::TLVDictionary(const uint8_t* data, size_t size)
+    : m_data(data)
+    , m_size(size)
+{
+    m_valid = Validate();
+}
+
+/*  Builds the dictionary of the 'entries' to 'out' */
+bool TLVDictionary::Build(std::vector<Entry>& entries, std::vector<uint8_t>& out)
+{
+    if (entries.size() >= s_noEntry) {
+        return false;
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.first < b.first; });
+
+    size_t maxId = 0;
+    size_t namesSize = 0;
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        if (entries[i].first.length() > UINT16_MAX || (i && entries[i].first == entries[i - 1].first)) {
+            return false;
+        }
+        maxId = std::max<size_t>(maxId, entries[i].second);
+        namesSize += entries[i].first.length();
+    }
+
+    size_t idsPos = s_headerSize + entries.size() * s_entrySize;
+    size_t namesPos = idsPos + IdTableSize(maxId);
+    out.assign(namesPos + namesSize, 0);
+
+    memcpy(&out[0], s_magic, sizeof(s_magic));
+    out[4] = s_version;
+    Put32(&out[8], static_cast<uint32_t>(entries.size()));
+    Put32(&out[12], static_cast<uint32_t>(maxId));
+    for (size_t id = 0; id <= maxId; ++id) {
+        Put16(&out[idsPos + 2 * id], s_noEntry);
+    }
+
+    size_t nameOffset = 0;
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        uint8_t* entry = &out[s_headerSize + i * s_entrySize];
+        Put32(entry, static_cast<uint32_t>(nameOffset));
+        Put16(entry + 4, static_cast<uint16_t>(entries[i].first.length()));
+        entry[6] = entries[i].second;
+        Put16(&out[idsPos + 2 * entries[i].second], static_cast<uint16_t>(i));
+
+        memcpy(out.data() + namesPos + nameOffset, entries[i].first.data(), entries[i].first.length());
+        nameOffset += entries[i].first.length();
+    }
+    return true;
+}
+
+/*  Gets the ID of the 'name' - binary search over the sorted entries */
+uint8_t TLVDictionary::Find(std::string_view name) const
+{
+    if (!m_valid) {
+        return 0;
+    }
+    size_t lo = 0, hi = m_count;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        Entry entry = At(mid);
+        int cmp = entry.first.compare(name);
+        if (cmp == 0) {
+            return entry.second;
+        }
+        if (cmp < 0) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return 0;
+}
+
+/*  Gets the name of the 'id' via the ID table */
+std::string_view TLVDictionary::Name(uint8_t id) const
+{
+    if (!m_valid || id > m_maxId) {
+        return std::string_view();
+    }
+    uint16_t index = Get16(m_ids + 2 * id);
+    return index == s_noEntry ? std::string_view() : At(index).first;
+}
+
+/*  Gets the i-th entry in the name order */
+TLVDictionary::Entry TLVDictionary::At(size_t index) const
+{
+    const uint8_t* entry = m_entries + index * s_entrySize;
+    std::string_view name(reinterpret_cast<const char*>(m_names + Get32(entry)), Get16(entry + 4));
+    return Entry(name, entry[6]);
+}
+
+/*  Checks the header, the tables and that every name is inside the names block */
+bool TLVDictionary::Validate()
+{
+    if (m_size < s_headerSize || memcmp(m_data, s_magic, sizeof(s_magic)) != 0 || m_data[4] != s_version) {
+        return false;
+    }
+    m_count = Get32(m_data + 8);
+    m_maxId = Get32(m_data + 12);
+    if (m_count >= s_noEntry || m_maxId > UINT8_MAX) {
+        return false;
+    }
+    size_t idsPos = s_headerSize + m_count * s_entrySize;
+    size_t namesPos = idsPos + IdTableSize(m_maxId);
+    if (m_size < namesPos) {
+        return false;
+    }
+    m_entries = m_data + s_headerSize;
+    m_ids = m_data + idsPos;
+    m_names = m_data + namesPos;
+    m_namesSize = m_size - namesPos;
+
+    for (size_t i = 0; i < m_count; ++i)
+    {
+        const uint8_t* entry = m_entries + i * s_entrySize;
+        if (Get32(entry) > m_namesSize || m_namesSize - Get32(entry) < Get16(entry + 4) || entry[6] > m_maxId) {
+            return false;
+        }
+    }
+    for (size_t id = 0; id <= m_maxId; ++id)
+    {
+        uint16_t index = Get16(m_ids + 2 * id);
+        if (index != s_noEntry && (index >= m_count || m_entries[index * s_entrySize + 6] != id)) {
+            return false;
+        }
+    }
+    return true;
+}
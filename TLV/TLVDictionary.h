@@ -0,0 +1,65 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+/*  Indexed dictionary - the "name":ID pairs laid out for the lookups right in the file bytes (e.g. mmap-ed), without decoding:
+ *
+ *  Header      | magic "TLVD" | version (1) | 3 reserved bytes | count: u32 | maxId: u32 |                           16 bytes
+ *  Entries     | count x { nameOffset: u32 | nameLength: u16 | id: u8 | reserved: u8 } - sorted by name bytes         8 * count
+ *  ID table    | (maxId + 1) x u16 - index of the entry of that ID (0xFFFF - no such ID), padded to 4 bytes
+ *  Names       | the names one after another, in the entries' order (offsets are relative to this block)
+ *
+ *  All the numbers are little endian. Name => ID is a binary search over the entries (O(log n)), ID => name is O(1) via the ID
+ *  table. Entry and table offsets are 4-byte aligned, so the mapped file may be read in place.
+ */
+class TLVDictionary
+{
+public:
+    using Entry = std::pair<std::string_view, uint8_t>;
+
+    static const uint8_t s_version = 1;
+    static const size_t  s_headerSize = 16;
+    static const size_t  s_entrySize = 8;
+    static const uint16_t s_noEntry = 0xFFFF;
+
+public:
+    /*  Views the dictionary in 'data'. Check Valid() before the lookups */
+    TLVDictionary(const uint8_t* data, size_t size);
+
+    /*  Builds the dictionary of the 'entries' (their order doesn't matter) to 'out'. Returns false if the names repeat or don't
+     *  fit (name longer than 0xFFFF, more than 0xFFFE entries) */
+    static bool Build(std::vector<Entry>& entries, std::vector<uint8_t>& out);
+
+    /*  Checks the data is a well-formed dictionary */
+    bool Valid() const                  { return m_valid; }
+
+    /*  Gets the number of the entries */
+    size_t Count() const                { return m_count; }
+
+    /*  Gets the ID of the 'name' (0 if there is no such name) */
+    uint8_t Find(std::string_view name) const;
+
+    /*  Gets the name of the 'id' (empty if there is no such ID) */
+    std::string_view Name(uint8_t id) const;
+
+    /*  Gets the i-th entry in the name order */
+    Entry At(size_t index) const;
+
+private:
+    /*  Checks the header, the tables and that every name is inside the names block */
+    bool Validate();
+
+    const uint8_t* m_data;
+    size_t         m_size;
+    size_t         m_count = 0;
+    size_t         m_maxId = 0;
+    const uint8_t* m_entries = nullptr;
+    const uint8_t* m_ids = nullptr;
+    const uint8_t* m_names = nullptr;
+    size_t         m_namesSize = 0;
+    bool           m_valid = false;
+};
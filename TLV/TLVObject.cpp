@@ -1,35 +1,91 @@
 #include "TLVObject.h"
+#include "BulkIntegerCodec.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <iterator>
+#include <string.h>
 
 
-const size_t  TLVObject::s_lenLimit = 0xFFFFFF;
+const size_t  TLVObject::s_lenLimit = SIZE_MAX;
+const size_t  TLVObject::s_streamChunkSize = 64 * 1024;
 const uint8_t TLVObject::s_lenWidth_1Byte = 0x7F;
 const uint8_t TLVObject::s_lenWidth_2Byte = 0x81;
 const uint8_t TLVObject::s_lenWidth_3Byte = 0x82;
 const uint8_t TLVObject::s_lenWidth_4Byte = 0x83;
+const uint8_t TLVObject::s_lenWidth_5Byte = 0x84;
+const uint8_t TLVObject::s_lenWidth_9Byte = 0x88;
+
+struct TLVObject::FlushTarget
+{
+    std::string   path;
+    std::ofstream out;
+    bool          failed = false;
+};
+
+TLVObject::TLVObject() = default;
+TLVObject::~TLVObject() = default;
 
 TLVObject::TLVObject(TLVObject&& src) noexcept
     : m_bytes(std::move(src.m_bytes))
-{}
+    , m_flush(std::move(src.m_flush))
+    , m_flushThreshold(src.m_flushThreshold)
+    , m_flushedBytes(src.m_flushedBytes)
+    , m_peakCapacity(src.m_peakCapacity)
+{
+    src.m_flushThreshold = SIZE_MAX;
+    src.m_flushedBytes = 0;
+    src.m_peakCapacity = 0;
+}
 
 TLVObject& TLVObject::operator=(TLVObject&& src) noexcept
 {
     m_bytes = std::move(src.m_bytes);
+    m_flush = std::move(src.m_flush);
+    m_flushThreshold = src.m_flushThreshold;
+    m_flushedBytes = src.m_flushedBytes;
+    m_peakCapacity = src.m_peakCapacity;
+    src.m_flushThreshold = SIZE_MAX;
+    src.m_flushedBytes = 0;
+    src.m_peakCapacity = 0;
     return *this;
 }
 
+/*  Clears internal binary buffer, returning the TLVObject to its initial state. In the flushing mode the file is truncated */
+void TLVObject::Clear()
+{
+    m_bytes.clear();
+    if (m_flush && m_flushedBytes)
+    {
+        m_flush->out.close();
+        m_flush->out.open(m_flush->path, std::ios::binary | std::ios::out | std::ios::trunc);
+        m_flush->failed |= !m_flush->out.is_open();
+    }
+    m_flushedBytes = 0;
+}
+
 /*  Encodes the boolean val */
 bool TLVObject::WriteBool(bool val)
 {
     m_bytes.push_back(static_cast<uint8_t>(val ? Tag::Bool_T : Tag::Bool_F));         // Tag (just tag - it's enough for boolean)
+    MaybeFlush();
     return true;
 }
 
+/*  Non-template part of WriteIntegers() - grows the buffer once and lets the BulkIntegerCodec fill it */
+void TLVObject::WriteIntegers(Tag tag, const void* values, size_t count, size_t width)
+{
+    size_t pos = m_bytes.size();
+    m_bytes.resize(pos + count * (1 + width));
+    if (count) {
+        BulkIntegerCodec::Encode(&m_bytes[pos], static_cast<uint8_t>(tag), values, count, width);
+    }
+    MaybeFlush();
+}
+
 /*  Encodes the string str */
-bool TLVObject::WriteString(const std::string& str)
+bool TLVObject::WriteString(std::string_view str)
 {
     m_bytes.push_back(static_cast<uint8_t>(Tag::String));       // Put the Tag
 
@@ -42,10 +98,103 @@ bool TLVObject::WriteString(const std::string& str)
     {
         return false;
     }
+    if (m_flush && m_bytes.size() + str.length() >= m_flushThreshold)
+    {
+        Flush();                                                // The value goes to the file as is - never to the buffer
+        WriteOut(reinterpret_cast<const uint8_t*>(str.data()), str.length());
+        return true;
+    }
     m_bytes.insert(m_bytes.end(), str.begin(), str.end());      // Put the Value
+    MaybeFlush();
+    return true;
+}
+
+/*  Encodes the string read from the 'source' chunk by chunk straight into the buffer */
+bool TLVObject::WriteString(const StringSource& source, size_t chunkSize)
+{
+    m_bytes.push_back(static_cast<uint8_t>(Tag::String));       // Put the Tag
+
+    size_t lengthPos = Size();
+    m_bytes.resize(m_bytes.size() + 9);                         // Reserve the widest Length field - it's patched at the end
+    size_t length = 0;
+
+    while (true)
+    {
+        size_t pos = m_bytes.size();
+        m_bytes.resize(pos + chunkSize);
+        size_t got = source(&m_bytes[pos], chunkSize);
+        m_bytes.resize(pos + got);
+        if (got == 0) {
+            break;
+        }
+        length += got;
+        MaybeFlush();
+    }
+    uint8_t field[9];
+    PutLength(field, length, true);
+    Patch(lengthPos, field, sizeof(field));                     // The Length may have gone to the file already
+    MaybeFlush();
     return true;
 }
 
+/*  Encodes the string of the known 'length' read from the 'source' in pieces */
+bool TLVObject::WriteSizedString(size_t length, const StringSource& source)
+{
+    m_bytes.push_back(static_cast<uint8_t>(Tag::String));       // Put the Tag
+    if (!WriteLength(length)) {
+        return false;
+    }
+    size_t pieceSize = m_flush ? std::min(std::max<size_t>(m_flushThreshold, 1), s_streamChunkSize) : length;
+
+    while (length)
+    {
+        size_t want = std::min(length, pieceSize);
+        size_t pos = m_bytes.size();
+        m_bytes.resize(pos + want);
+        size_t got = source(&m_bytes[pos], want);
+        m_bytes.resize(pos + got);
+        if (got == 0) {
+            return false;
+        }
+        length -= got;
+        MaybeFlush();
+    }
+    return true;
+}
+
+/*  Reserves the room for the string of up to 'maxLength' bytes and returns the pointer the value is to be written to */
+uint8_t* TLVObject::BeginString(size_t maxLength)
+{
+    if (maxLength > s_lenLimit) {
+        return nullptr;
+    }
+    if (m_flush) {
+        Flush();                                                // So the buffer holds the value alone
+    }
+    m_bytes.push_back(static_cast<uint8_t>(Tag::String));       // Put the Tag
+
+    m_stringLengthPos = m_bytes.size();
+    m_stringValuePos = m_stringLengthPos + LengthFieldSize(maxLength);
+    m_bytes.resize(m_stringValuePos + maxLength);
+    return &m_bytes[m_stringValuePos];
+}
+
+/*  Completes the string started with BeginString() - puts the Length field before the value. If the actual length takes less
+ *  octets than the reserved one - value is moved back to stay right after the Length */
+void TLVObject::EndString(size_t length)
+{
+    size_t reserved = m_stringValuePos - m_stringLengthPos;
+    uint8_t width = LengthFieldSize(length);
+    uint8_t* field = &m_bytes[m_stringLengthPos];
+
+    if (width < reserved) {
+        memmove(field + width, field + reserved, length);
+    }
+    PutLength(field, length);
+    m_bytes.resize(m_stringLengthPos + width + length);
+    MaybeFlush();
+}
+
 /*  Separate method to write the 'Length'  field where it's necessary  (for strings, for example). Length is encoded by the rules
  *  in the class description */
 bool TLVObject::WriteLength(size_t length)
@@ -53,39 +202,80 @@ bool TLVObject::WriteLength(size_t length)
     if (length > s_lenLimit) {
         return false;
     }
+    size_t pos = m_bytes.size();
+    m_bytes.resize(pos + LengthFieldSize(length));
+    PutLength(&m_bytes[pos], length);
+    return true;
+}
+
+/*  Gets the number of octets the Length field takes for the 'length' */
+uint8_t TLVObject::LengthFieldSize(size_t length)
+{
+    if (length <= s_lenWidth_1Byte) return 1;
+    if (length <= 0xFF)             return 2;
+    if (length <= 0xFFFF)           return 3;
+    if (length <= 0xFFFFFF)         return 4;
+    if (length <= 0xFFFFFFFF)       return 5;
+    return 9;
+}
 
+/*  Puts the Length field for the 'length' to 'dst' (must have the room for LengthFieldSize(length) octets, or 9 octets if 'wide'
+ *  is set - then the 0x88 form is used whatever the length is) */
+void TLVObject::PutLength(uint8_t* dst, size_t length, bool wide)
+{
+    // If 'wide' or len is above 0xFFFFFFFF - then 1st octet indicates that length is stored in the next 8 octets
+    if (wide || LengthFieldSize(length) == 9)
+    {
+        dst[0] = s_lenWidth_9Byte;
+        for (int i = 1; i <= 8; ++i) {
+            dst[i] = static_cast<uint8_t>(static_cast<uint64_t>(length) >> (8 * (8 - i)));
+        }
+    }
     // If len is [0 ... 0x7F] - its value will be in the 1st octet as it
-    if (length <= s_lenWidth_1Byte)
+    else if (length <= s_lenWidth_1Byte)
     {
-        m_bytes.push_back(static_cast<uint8_t>(length));
+        dst[0] = static_cast<uint8_t>(length);
     }
     // If len is [0x80 ... 0xFF] - then 1st octet indicates that length is stored in 2nd octet
     else if (length <= 0xFF)
     {
-        m_bytes.push_back(s_lenWidth_2Byte);
-        m_bytes.push_back(static_cast<uint8_t>(length));
+        dst[0] = s_lenWidth_2Byte;
+        dst[1] = static_cast<uint8_t>(length);
     }
     // If len is [0x0100 ... 0xFFFF] - then 1st octet indicates that length is stored in 2nd and 3rd octets
     else if (length <= 0xFFFF)
     {
-        m_bytes.push_back(s_lenWidth_3Byte);
-        m_bytes.push_back(static_cast<uint8_t>(length >> 8));
-        m_bytes.push_back(static_cast<uint8_t>(length & 0x00FF));
+        dst[0] = s_lenWidth_3Byte;
+        dst[1] = static_cast<uint8_t>(length >> 8);
+        dst[2] = static_cast<uint8_t>(length & 0x00FF);
     }
     // If len is [0x010000 ... 0xFFFFFF] - then 1st octet indicates that length is stored in 2nd, 3rd and 4th octets
+    else if (length <= 0xFFFFFF)
+    {
+        dst[0] = s_lenWidth_4Byte;
+        dst[1] = static_cast<uint8_t>(length >> 16);
+        dst[2] = static_cast<uint8_t>((length >> 8) & 0x0000FF);
+        dst[3] = static_cast<uint8_t>(length & 0x00FF);
+    }
+    // If len is [0x01000000 ... 0xFFFFFFFF] - then 1st octet indicates that length is stored in the next 4 octets
     else
     {
-        m_bytes.push_back(s_lenWidth_4Byte);
-        m_bytes.push_back(static_cast<uint8_t>(length >> 16));
-        m_bytes.push_back(static_cast<uint8_t>((length >> 8) & 0x0000FF));
-        m_bytes.push_back(static_cast<uint8_t>(length & 0x00FF));
+        dst[0] = s_lenWidth_5Byte;
+        dst[1] = static_cast<uint8_t>(length >> 24);
+        dst[2] = static_cast<uint8_t>((length >> 16) & 0x0000FF);
+        dst[3] = static_cast<uint8_t>((length >> 8) & 0x0000FF);
+        dst[4] = static_cast<uint8_t>(length & 0x00FF);
     }
-    return true;
 }
 
 /*  Dumps to the file 'filePath' the binary data encoded with 'Write*' calls */
 bool TLVObject::Dump(const std::string& filePath)
 {
+    if (m_flush) {
+        std::cout << "Record is being flushed to: " << m_flush->path << std::endl;
+        return false;
+    }
+
     std::ofstream out(filePath, std::ios::binary | std::ios::out);
 
     if (!out.is_open()) {
@@ -97,3 +287,85 @@ bool TLVObject::Dump(const std::string& filePath)
     out.close();
     return true;
 }
+
+/*  Switches to the flushing mode - encoded data goes to the file 'filePath' every time the buffer grows over the 'threshold' */
+bool TLVObject::StartFlushing(const std::string& filePath, size_t threshold)
+{
+    if (m_flush) {
+        FinishFlushing();
+    }
+    std::unique_ptr<FlushTarget> target(new FlushTarget);
+    target->path = filePath;
+    target->out.open(filePath, std::ios::binary | std::ios::out | std::ios::trunc);
+
+    if (!target->out.is_open()) {
+        std::cout << "Unable to open the file for record: " << filePath << std::endl;
+        return false;
+    }
+    m_flush = std::move(target);
+    m_flushThreshold = threshold;
+    m_flushedBytes = 0;
+    m_peakCapacity = 0;
+    MaybeFlush();
+    return true;
+}
+
+/*  Writes the rest of the data, closes the file and returns to the in-memory mode */
+bool TLVObject::FinishFlushing()
+{
+    if (!m_flush) {
+        return false;
+    }
+    Flush();
+    m_flush->out.close();
+    bool ok = !m_flush->failed && !m_flush->out.fail();
+
+    m_flush.reset();
+    m_flushThreshold = SIZE_MAX;
+    m_flushedBytes = 0;
+    return ok;
+}
+
+/*  Drains the buffer to the file */
+void TLVObject::Flush()
+{
+    if (!m_flush || m_bytes.empty()) {
+        return;
+    }
+    WriteOut(m_bytes.data(), m_bytes.size());
+    m_peakCapacity = std::max(m_peakCapacity, m_bytes.capacity());
+    m_bytes.clear();
+    if (m_bytes.capacity() / 2 > m_flushThreshold)
+    {
+        Bytes().swap(m_bytes);                  // Don't keep the room of a huge value for the rest of the lines
+        m_bytes.reserve(m_flushThreshold);
+    }
+}
+
+/*  Appends 'size' bytes of 'data' to the file, past the flushed part */
+void TLVObject::WriteOut(const uint8_t* data, size_t size)
+{
+    m_flush->out.write(reinterpret_cast<const char*>(data), size);
+    m_flush->failed |= m_flush->out.fail();
+    m_flushedBytes += size;
+}
+
+/*  Overwrites 'size' bytes at the offset 'pos' of the encoded data. The part which has gone to the file already is rewritten in
+ *  place, then the file position is returned to the end */
+void TLVObject::Patch(size_t pos, const uint8_t* data, size_t size)
+{
+    if (pos < m_flushedBytes)
+    {
+        size_t inFile = std::min(size, m_flushedBytes - pos);
+        m_flush->out.seekp(static_cast<std::streamoff>(pos));
+        m_flush->out.write(reinterpret_cast<const char*>(data), inFile);
+        m_flush->out.seekp(0, std::ios::end);
+        m_flush->failed |= m_flush->out.fail();
+        pos += inFile;
+        data += inFile;
+        size -= inFile;
+    }
+    if (size) {
+        memcpy(&m_bytes[pos - m_flushedBytes], data, size);
+    }
+}
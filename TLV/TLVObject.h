@@ -1,6 +1,11 @@
 #pragma once
 #include <stdint.h>
+#include <functional>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 class TLVTester;
@@ -14,23 +19,38 @@ class TLVTester;
  *  -- String uses all the TLV fields.
  *  As said earlier, for the standard types we have predefined Tags - see enum TLVObject::Tag.
  *
- *  TLV supports maximum value of the Length field: 0xFFFFFF; To encode the Length field we're using the next rules:
+ *  TLV supports the Length field values up to 8 bytes wide. To encode the Length field we're using the next rules:
  *  -- If length is 7bit value (e.g. 0...127) - it will be written as one byte as it is (15 => 0x0F).
  *  -- If length is 1-byte value (e.g. 0x80...0xFF) - first byte will be 0x81, and next one - the length (0xE8 => 0x81, 0xE8).
  *  -- If length is 2-byte value (e.g. 0x0100...0xFFFF) - first byte will be 0x82, and two next ones - the length
  *     (0x75A2 => 0x82, 0x75, 0xA2)
  *  -- If length is 3-byte value (e.g. 0x010000...0xFFFFFF) - first byte will be 0x0x83, and three next bytes - the length
  *     (0x53A9C7 => 0x83, 0x53, 0xA9, 0xC7)
+ *  -- If length is 4-byte value (e.g. 0x01000000...0xFFFFFFFF) - first byte will be 0x84, and four next bytes - the length
+ *     (0x1A2B3C4D => 0x84, 0x1A, 0x2B, 0x3C, 0x4D)
+ *  -- If length is wider - first byte will be 0x88, and eight next bytes - the length
+ *     (0x0123456789 => 0x88, 0x00, 0x00, 0x00, 0x01, 0x23, 0x45, 0x67, 0x89)
+ *  The strings streamed with WriteString(StringSource) always use 0x88 form, since their length is not known in advance.
+ *
+ *  By default the encoded data is kept in memory up to the Dump() call. For the very large records TLVObject may work in flushing
+ *  mode (see StartFlushing()):  the buffer is drained to the file every time it grows over the threshold, and the Length fields
+ *  which went to the file before their value was complete are back-patched with positional writes. The string values bigger than
+ *  the threshold go to the file straight or in pieces, and the buffer is shrunk back after a flush - so the memory the object
+ *  takes stays bounded whatever the record size is.
  */
 class TLVObject
 {
     friend class TLVTester;
+    friend class TLVReader;
 
     static const size_t  s_lenLimit;
+    static const size_t  s_streamChunkSize;
     static const uint8_t s_lenWidth_1Byte;
     static const uint8_t s_lenWidth_2Byte;
     static const uint8_t s_lenWidth_3Byte;
     static const uint8_t s_lenWidth_4Byte;
+    static const uint8_t s_lenWidth_5Byte;
+    static const uint8_t s_lenWidth_9Byte;
 
 public:
     // Predefined Tags for standard types
@@ -49,10 +69,14 @@ public:
         Invalid
     };
 
+    /*  Source of the streamed string value: fills up to 'capacity' bytes of the 'buffer' and returns the number of bytes given.
+     *  Zero means the value is over */
+    using StringSource = std::function<size_t(uint8_t* buffer, size_t capacity)>;
+
 public:
-    TLVObject() = default;
+    TLVObject();
 
-    ~TLVObject() = default;
+    ~TLVObject();
 
     TLVObject(const TLVObject&) = delete;
 
@@ -69,47 +93,162 @@ public:
     template<class T>
     bool WriteInteger(T val);
 
+    /*  Encodes 'count' integers from 'values' - the same bytes as 'count' WriteInteger() calls give, but byte-swapped in bulk (see
+     *  BulkIntegerCodec) and stored to the buffer grown just once */
+    template<class T>
+    bool WriteIntegers(const T* values, size_t count);
+
     /*  Encodes the string str */
-    bool WriteString(const std::string& str);
+    bool WriteString(std::string_view str);
+
+    /*  Encodes the string of 'length' chars starting from 'str' */
+    bool WriteString(const char* str, size_t length)    { return WriteString(std::string_view(str, length)); }
+
+    /*  Encodes the string read from the 'source' chunk by chunk  (up to 'chunkSize' bytes per call) straight into the buffer. The
+     *  Length field is reserved in 0x88 form and patched when the source is over - so the value is never buffered twice */
+    bool WriteString(const StringSource& source, size_t chunkSize = s_streamChunkSize);
+
+    /*  Encodes the string of the known 'length' read from the 'source' in pieces. Unlike the streamed WriteString() the Length
+     *  field takes its usual (shortest) form;  in the flushing mode the pieces are up to the threshold, so the buffer never holds
+     *  the whole value. Returns false if the source gives less than 'length' bytes */
+    bool WriteSizedString(size_t length, const StringSource& source);
+
+    /*  Starts the string whose value is written in place: puts the Tag, reserves the Length field for the 'maxLength' and returns
+     *  the pointer to the room of 'maxLength' bytes for the value (nullptr if 'maxLength' is too big). Must be completed with the
+     *  EndString() before any other 'Write*' call. The room is in the buffer whatever the mode is - the values bigger than the
+     *  flush threshold are better written with WriteSizedString() */
+    uint8_t* BeginString(size_t maxLength);
+
+    /*  Completes the string started with BeginString() - 'length' is the number of value bytes actually written */
+    void EndString(size_t length);
 
     /*  Dumps to the file 'filePath' the binary data encoded with 'Write*' calls */
     bool Dump(const std::string& filePath);
 
-    /*  Clears internal binary buffer, returning the TLVObject to its initial state */
-    void Clear()        { m_bytes.clear(); }
+    /*  Switches to the flushing mode: encoded data goes to the file 'filePath' (truncated) every time the buffer grows over the
+     *  'threshold' bytes. Data encoded before the call is written first */
+    bool StartFlushing(const std::string& filePath, size_t threshold);
+
+    /*  Writes the rest of the data, closes the file and returns to the in-memory mode. Returns false if any write has failed */
+    bool FinishFlushing();
+
+    /*  Checks whether the object is in the flushing mode */
+    bool Flushing() const       { return m_flush != nullptr; }
+
+    /*  Gets the threshold of the flushing mode (SIZE_MAX in the in-memory mode) */
+    size_t FlushThreshold() const   { return m_flushThreshold; }
+
+    /*  Gets the largest capacity the buffer has had since the flushing mode was started (or the current one in the in-memory
+     *  mode) - the memory the record has actually taken */
+    size_t PeakCapacity() const     { return m_peakCapacity > m_bytes.capacity() ? m_peakCapacity : m_bytes.capacity(); }
+
+    /*  Preallocates the internal binary buffer for 'size' bytes of encoded data */
+    void Reserve(size_t size)   { m_bytes.reserve(size); }
+
+    /*  Clears internal binary buffer, returning the TLVObject to its initial state. In the flushing mode the file is truncated */
+    void Clear();
 
     /*  Checks whether TLV has the data encoded */
-    bool Empty() const  { return m_bytes.empty(); }
+    bool Empty() const  { return Size() == 0; }
+
+    /*  Gets the size of encoded data (including the flushed one) */
+    size_t Size() const { return m_flushedBytes + m_bytes.size(); }
+
+    /*  Gets the encoded data (in the flushing mode - just the part not flushed yet) */
+    const uint8_t* Data() const { return m_bytes.data(); }
 
-    /*  Gets the size of encoded data */
-    size_t Size() const { return m_bytes.size(); }
+    /*  Gets the size of the encoded string of 'length' bytes */
+    static size_t StringSize(size_t length)     { return 1 + LengthFieldSize(length) + length; }
+
+    /*  Gets the Tag for the integer type T (Tag::Invalid if T is not supported) */
+    template<class T>
+    static constexpr Tag IntegerTag();
 
 private:
     /*  Separate method to write the 'Length'  field where it's necessary  (for strings, for example).   Length is encoded by the
      *  rules are described above, in the class description */
     bool WriteLength(size_t length);
 
-    std::vector<uint8_t> m_bytes;
+    /*  Gets the number of octets the Length field takes for the 'length' */
+    static uint8_t LengthFieldSize(size_t length);
+
+    /*  Puts the Length field for the 'length' to 'dst' (in 0x88 form if 'wide') */
+    static void PutLength(uint8_t* dst, size_t length, bool wide = false);
+
+    /*  Non-template part of WriteIntegers() */
+    void WriteIntegers(Tag tag, const void* values, size_t count, size_t width);
+
+    /*  Drains the buffer to the file if it has grown over the threshold (never happens in the in-memory mode) */
+    void MaybeFlush()   { if (m_bytes.size() >= m_flushThreshold) Flush(); }
+
+    /*  Drains the buffer to the file. The buffer grown much over the threshold is shrunk back to it */
+    void Flush();
+
+    /*  Appends 'size' bytes of 'data' to the file, past the flushed part */
+    void WriteOut(const uint8_t* data, size_t size);
+
+    /*  Overwrites 'size' bytes at the offset 'pos' of the encoded data - in the file or in the buffer */
+    void Patch(size_t pos, const uint8_t* data, size_t size);
+
+    struct FlushTarget;
+
+    /*  Allocator leaving the bytes added by resize() uninitialised - they are written right after it (e.g. BeginString() gives
+     *  the room the decoder writes the value to), so zero-filling them first is a wasted pass over the memory */
+    template<class T>
+    struct DefaultInitAllocator : std::allocator<T>
+    {
+        template<class U>
+        struct rebind { using other = DefaultInitAllocator<U>; };
+
+        DefaultInitAllocator() = default;
+
+        template<class U>
+        DefaultInitAllocator(const DefaultInitAllocator<U>&) noexcept {}
+
+        template<class U>
+        void construct(U* p) noexcept(std::is_nothrow_default_constructible<U>::value)     { ::new (static_cast<void*>(p)) U; }
+
+        template<class U, class... Args>
+        void construct(U* p, Args&&... args)    { ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...); }
+    };
+
+    using Bytes = std::vector<uint8_t, DefaultInitAllocator<uint8_t>>;
+
+    Bytes                m_bytes;
+    std::unique_ptr<FlushTarget> m_flush;
+    size_t               m_flushThreshold = SIZE_MAX;
+    size_t               m_flushedBytes = 0;
+    size_t               m_peakCapacity = 0;
+    size_t               m_stringLengthPos = 0;     // Positions of the Length field and the value of the string started by
+    size_t               m_stringValuePos = 0;      // BeginString()
 };
 
 
+/*  Gets the Tag for the integer type T */
+template<class T>
+constexpr TLVObject::Tag TLVObject::IntegerTag()
+{
+    constexpr bool isSigned = std::is_signed<T>::value;
+
+    switch (sizeof(T)) {
+        case 1:  return isSigned ? Tag::Integer_S8  : Tag::Integer_U8;
+        case 2:  return isSigned ? Tag::Integer_S16 : Tag::Integer_U16;
+        case 4:  return isSigned ? Tag::Integer_S32 : Tag::Integer_U32;
+        case 8:  return isSigned ? Tag::Integer_S64 : Tag::Integer_U64;
+        default: return Tag::Invalid;
+    }
+}
+
 /*  Encodes the integer. Supports signed/unsigned integers up to 8-byte size */
 template<class T>
 bool TLVObject::WriteInteger(T val)
 {
     static_assert(std::is_integral<T>::value && "Supposed to be used with an integer types");
 
-    constexpr bool isSigned = std::is_signed<T>::value;
     constexpr uint8_t length = sizeof(T);
-
-    Tag tag;
-    switch (length) {
-        case 1:  tag = isSigned ? Tag::Integer_S8  : Tag::Integer_U8;  break;
-        case 2:  tag = isSigned ? Tag::Integer_S16 : Tag::Integer_U16; break;
-        case 4:  tag = isSigned ? Tag::Integer_S32 : Tag::Integer_U32; break;
-        case 8:  tag = isSigned ? Tag::Integer_S64 : Tag::Integer_U64; break;
-        default:
-            return false;
+    constexpr Tag tag = IntegerTag<T>();
+    if (tag == Tag::Invalid) {
+        return false;
     }
     m_bytes.push_back(static_cast<uint8_t>(tag));    // Such a tag represents both the type and length - so next field is a value
 
@@ -120,5 +259,20 @@ bool TLVObject::WriteInteger(T val)
         uint8_t byte = 0xFF & (val >> shift);
         m_bytes.push_back(byte);
     }
+    MaybeFlush();
+    return true;
+}
+
+/*  Encodes 'count' integers from 'values' */
+template<class T>
+bool TLVObject::WriteIntegers(const T* values, size_t count)
+{
+    static_assert(std::is_integral<T>::value && "Supposed to be used with an integer types");
+
+    constexpr Tag tag = IntegerTag<T>();
+    if (tag == Tag::Invalid) {
+        return false;
+    }
+    WriteIntegers(tag, values, count, sizeof(T));
     return true;
-}
\ No newline at end of file
+}
@@ -0,0 +1,118 @@
+#include "TLVReader.h"
+#include "BulkIntegerCodec.h"
+
+
+/*  Gets the Tag of the next item */
+TLVObject::Tag TLVReader::PeekTag() const
+{
+    if (m_pos == m_size || m_data[m_pos] == 0 || m_data[m_pos] >= static_cast<uint8_t>(TLVObject::Tag::Invalid)) {
+        return TLVObject::Tag::Invalid;
+    }
+    return static_cast<TLVObject::Tag>(m_data[m_pos]);
+}
+
+/*  Decodes the boolean */
+bool TLVReader::ReadBool(bool& val)
+{
+    TLVObject::Tag tag = PeekTag();
+    if (tag != TLVObject::Tag::Bool_T && tag != TLVObject::Tag::Bool_F) {
+        return false;
+    }
+    val = tag == TLVObject::Tag::Bool_T;
+    ++m_pos;
+    return true;
+}
+
+/*  Decodes the string */
+bool TLVReader::ReadString(std::string_view& str)
+{
+    if (PeekTag() != TLVObject::Tag::String) {
+        return false;
+    }
+    size_t pos = m_pos + 1;
+    size_t length;
+    if (!ReadLength(pos, length) || m_size - pos < length) {
+        return false;
+    }
+    str = std::string_view(reinterpret_cast<const char*>(m_data + pos), length);
+    m_pos = pos + length;
+    return true;
+}
+
+/*  Skips the next item whatever its Tag is */
+bool TLVReader::Skip()
+{
+    TLVObject::Tag tag = PeekTag();
+    size_t width;
+
+    switch (tag) {
+        case TLVObject::Tag::Invalid:       return false;
+        case TLVObject::Tag::String:
+        {
+            std::string_view str;
+            return ReadString(str);
+        }
+        case TLVObject::Tag::Bool_T:
+        case TLVObject::Tag::Bool_F:        width = 0;  break;
+        case TLVObject::Tag::Integer_S8:
+        case TLVObject::Tag::Integer_U8:    width = 1;  break;
+        case TLVObject::Tag::Integer_S16:
+        case TLVObject::Tag::Integer_U16:   width = 2;  break;
+        case TLVObject::Tag::Integer_S32:
+        case TLVObject::Tag::Integer_U32:   width = 4;  break;
+        default:                            width = 8;  break;
+    }
+    if (m_size - m_pos < 1 + width) {
+        return false;
+    }
+    m_pos += 1 + width;
+    return true;
+}
+
+/*  Reads the 'Length' field at 'pos', moving 'pos' to the value */
+bool TLVReader::ReadLength(size_t& pos, size_t& length) const
+{
+    if (pos >= m_size) {
+        return false;
+    }
+    uint8_t first = m_data[pos++];
+    if (first <= TLVObject::s_lenWidth_1Byte)
+    {
+        length = first;
+        return true;
+    }
+
+    size_t octets;
+    if      (first == TLVObject::s_lenWidth_2Byte)  octets = 1;
+    else if (first == TLVObject::s_lenWidth_3Byte)  octets = 2;
+    else if (first == TLVObject::s_lenWidth_4Byte)  octets = 3;
+    else if (first == TLVObject::s_lenWidth_5Byte)  octets = 4;
+    else if (first == TLVObject::s_lenWidth_9Byte)  octets = 8;
+    else                                            return false;
+
+    if (m_size - pos < octets) {
+        return false;
+    }
+    uint64_t value = 0;
+    for (size_t i = 0; i < octets; ++i) {
+        value = (value << 8) | m_data[pos++];
+    }
+    if (value > SIZE_MAX) {
+        return false;
+    }
+    length = static_cast<size_t>(value);
+    return true;
+}
+
+/*  Non-template part of ReadIntegers() - all the items must have the 'tag' */
+bool TLVReader::ReadIntegers(TLVObject::Tag tag, void* values, size_t count, size_t width)
+{
+    if (tag == TLVObject::Tag::Invalid || (m_size - m_pos) / (1 + width) < count) {
+        return false;
+    }
+    if (!BulkIntegerCodec::Decode(values, static_cast<uint8_t>(tag), m_data + m_pos, count, width)) {
+        return false;
+    }
+    m_pos += count * (1 + width);
+    return true;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "TLVObject.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+#include <type_traits>
+
+
+/*  Decoder of the data encoded with TLVObject. Reads the items one by one from the buffer it doesn't own (so the strings it gives
+ *  are the slices of this buffer). Each 'Read*' call checks the next item has the expected Tag and is not truncated - otherwise
+ *  it returns false and the reader stays where it was.
+ */
+class TLVReader
+{
+public:
+    TLVReader(const uint8_t* data, size_t size)
+        : m_data(data)
+        , m_size(size)
+    {}
+
+    /*  Gets the Tag of the next item (Tag::Invalid if there are no more items) */
+    TLVObject::Tag PeekTag() const;
+
+    /*  Decodes the boolean */
+    bool ReadBool(bool& val);
+
+    /*  Decodes the integer written for the same type T */
+    template<class T>
+    bool ReadInteger(T& val);
+
+    /*  Decodes 'count' integers written for the same type T to 'values' - the counterpart of TLVObject::WriteIntegers() */
+    template<class T>
+    bool ReadIntegers(T* values, size_t count);
+
+    /*  Decodes the string */
+    bool ReadString(std::string_view& str);
+
+    /*  Skips the next item whatever its Tag is */
+    bool Skip();
+
+    /*  Checks whether all the data is read */
+    bool AtEnd() const          { return m_pos == m_size; }
+
+    /*  Gets the offset of the next item */
+    size_t Position() const     { return m_pos; }
+
+private:
+    /*  Reads the 'Length' field encoded by the rules described for the TLVObject */
+    bool ReadLength(size_t& pos, size_t& length) const;
+
+    /*  Non-template part of ReadIntegers() */
+    bool ReadIntegers(TLVObject::Tag tag, void* values, size_t count, size_t width);
+
+    const uint8_t* m_data;
+    size_t         m_size;
+    size_t         m_pos = 0;
+};
+
+
+/*  Decodes the integer written for the same type T */
+template<class T>
+bool TLVReader::ReadInteger(T& val)
+{
+    static_assert(std::is_integral<T>::value && "Supposed to be used with an integer types");
+
+    if (PeekTag() != TLVObject::IntegerTag<T>() || m_size - m_pos < 1 + sizeof(T)) {
+        return false;
+    }
+    using U = typename std::make_unsigned<T>::type;
+    U raw = 0;
+    for (size_t i = 1; i <= sizeof(T); ++i) {
+        raw = static_cast<U>((raw << 8) | m_data[m_pos + i]);     // Big Endian
+    }
+    val = static_cast<T>(raw);
+    m_pos += 1 + sizeof(T);
+    return true;
+}
+
+/*  Decodes 'count' integers written for the same type T */
+template<class T>
+bool TLVReader::ReadIntegers(T* values, size_t count)
+{
+    static_assert(std::is_integral<T>::value && "Supposed to be used with an integer types");
+
+    return ReadIntegers(TLVObject::IntegerTag<T>(), values, count, sizeof(T));
+}
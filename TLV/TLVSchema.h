@@ -0,0 +1,200 @@
+#pragma once
+#include "TLVObject.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <array>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+
+/*  Compile-time description of a C++ struct to encode it straight to TLV - without making the JSON of it to be parsed again.
+ *  Records and dictionaries have the same layout the JSON convertor gives: the fields ordered by name, each one as its key ID
+ *  (1, 2, 3... in that order) followed by the value;  dictionary keeps the "name":ID pairs.  So the struct encodes to the same
+ *  bytes as its JSON line would, unless the line's integers fit narrower types than the declared ones (the declared width is
+ *  kept here). Value Tags are resolved at compile time, the key IDs - once the schema is made (at compile time for the constexpr
+ *  one). Supported field types: bool, integers up to 8 bytes, std::string and std::string_view.
+ *
+ *  struct Point { int32_t x; bool visible; std::string name; };
+ *
+ *  constexpr auto pointSchema = MakeTLVSchema<Point>(MakeTLVField("x", &Point::x),
+ *                                                    MakeTLVField("visible", &Point::visible),
+ *                                                    MakeTLVField("name", &Point::name));
+ *  pointSchema.Encode(point, record);
+ *  pointSchema.EncodeDictionary(dict);
+ */
+template<class S, class M>
+struct TLVField
+{
+    using Struct = S;
+    using Member = M;
+
+    std::string_view name;
+    M S::*           member;
+
+    /*  Size of the encoded key ID and value, known at compile time (0 for the strings) */
+    static constexpr size_t FixedSize()
+    {
+        if constexpr (std::is_same<M, bool>::value) {
+            return 2 + 1;
+        }
+        else if constexpr (std::is_integral<M>::value) {
+            static_assert(TLVObject::IntegerTag<M>() != TLVObject::Tag::Invalid, "Unsupported integer width");
+            return 2 + 1 + sizeof(M);
+        }
+        else {
+            static_assert(std::is_same<M, std::string>::value || std::is_same<M, std::string_view>::value,
+                          "Supported field types are bool, integers, std::string and std::string_view");
+            return 0;
+        }
+    }
+
+    /*  Size of the encoded key ID and value */
+    size_t EncodedSize(const S& obj) const
+    {
+        if constexpr (std::is_same<M, std::string>::value || std::is_same<M, std::string_view>::value) {
+            return 2 + TLVObject::StringSize((obj.*member).length());
+        }
+        else {
+            return FixedSize();
+        }
+    }
+
+    bool EncodeValue(const S& obj, TLVObject& record) const
+    {
+        if constexpr (std::is_same<M, bool>::value) {
+            return record.WriteBool(obj.*member);
+        }
+        else if constexpr (std::is_integral<M>::value) {
+            return record.WriteInteger(obj.*member);
+        }
+        else {
+            return record.WriteString(obj.*member);
+        }
+    }
+};
+
+template<class S, class M>
+constexpr TLVField<S, M> MakeTLVField(std::string_view name, M S::* member)
+{
+    return { name, member };
+}
+
+
+template<class S, class... Fields>
+class TLVSchema
+{
+    static_assert(sizeof...(Fields) > 0 && sizeof...(Fields) <= UINT8_MAX, "Key IDs are 1-byte values");
+    static_assert((std::is_same<typename Fields::Struct, S>::value && ...), "Fields must belong to the schema's struct");
+
+public:
+    /*  Number of the fields */
+    static constexpr size_t FieldCount = sizeof...(Fields);
+
+    /*  Encoded size of all the non-string fields - the whole record size if the struct has no strings */
+    static constexpr size_t FixedSize = (Fields::FixedSize() + ...);
+
+    /*  Whether the record always takes FixedSize bytes */
+    static constexpr bool IsFixedSize = ((Fields::FixedSize() != 0) && ...);
+
+public:
+    constexpr explicit TLVSchema(Fields... fields)
+        : m_fields(fields...)
+    {
+        // Insertion sort by name - the same order the JSON convertor gives to the keys of a line
+        std::array<std::string_view, FieldCount> names = { fields.name... };
+        for (size_t i = 0; i < FieldCount; ++i)
+        {
+            size_t pos = i;
+            for (; pos > 0 && names[i] < names[m_order[pos - 1]]; --pos) {
+                m_order[pos] = m_order[pos - 1];
+            }
+            m_order[pos] = static_cast<uint8_t>(i);
+        }
+        for (size_t rank = 0; rank < FieldCount; ++rank) {
+            m_ids[m_order[rank]] = static_cast<uint8_t>(rank + 1);
+        }
+    }
+
+    /*  Gets the size of the 'obj' record */
+    size_t EncodedSize(const S& obj) const
+    {
+        if constexpr (IsFixedSize) {
+            return FixedSize;
+        }
+        else {
+            return std::apply([&obj](const Fields&... fields) { return (fields.EncodedSize(obj) + ...); }, m_fields);
+        }
+    }
+
+    /*  Encodes the 'obj' to the 'record' */
+    bool Encode(const S& obj, TLVObject& record) const
+    {
+        for (size_t rank = 0; rank < FieldCount; ++rank)
+        {
+            if (!EncodeField(m_order[rank], obj, record, std::index_sequence_for<Fields...>())) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*  Encodes the dictionary ("name":ID pairs) of the schema to the 'dict' */
+    bool EncodeDictionary(TLVObject& dict) const
+    {
+        for (size_t rank = 0; rank < FieldCount; ++rank)
+        {
+            if (!EncodeName(m_order[rank], dict, std::index_sequence_for<Fields...>())) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*  Gets the key ID of the field 'name' (0 if there is no such field) */
+    constexpr uint8_t KeyId(std::string_view name) const
+    {
+        return FindKey(name, std::index_sequence_for<Fields...>());
+    }
+
+private:
+    /*  Encodes the key ID and value of the 'field'-th field */
+    template<size_t... I>
+    bool EncodeField(size_t field, const S& obj, TLVObject& record, std::index_sequence<I...>) const
+    {
+        bool ok = false;
+        ((I == field ? (ok = record.WriteInteger(m_ids[I]) && std::get<I>(m_fields).EncodeValue(obj, record), true) : false) ||
+         ...);
+        return ok;
+    }
+
+    /*  Encodes the name and key ID of the 'field'-th field */
+    template<size_t... I>
+    bool EncodeName(size_t field, TLVObject& dict, std::index_sequence<I...>) const
+    {
+        bool ok = false;
+        ((I == field ? (ok = dict.WriteString(std::get<I>(m_fields).name) && dict.WriteInteger(m_ids[I]), true) : false) || ...);
+        return ok;
+    }
+
+    template<size_t... I>
+    constexpr uint8_t FindKey(std::string_view name, std::index_sequence<I...>) const
+    {
+        uint8_t id = 0;
+        ((std::get<I>(m_fields).name == name ? (id = m_ids[I], true) : false) || ...);
+        return id;
+    }
+
+    std::tuple<Fields...>               m_fields;
+    std::array<uint8_t, FieldCount>     m_order {};     // Field indices ordered by name
+    std::array<uint8_t, FieldCount>     m_ids {};       // Key IDs of the fields - their positions in m_order, from 1
+};
+
+template<class S, class... Fields>
+constexpr TLVSchema<S, Fields...> MakeTLVSchema(Fields... fields)
+{
+    return TLVSchema<S, Fields...>(fields...);
+}
@@ -0,0 +1,308 @@
+#include "TLVConvert.h"
+
+#include "JsonToTLV/JsonToTlvConverter.h"
+#include "JsonToTLV/KeySet.h"
+#include "TLVDictionary.h"
+#include "TLVReader.h"
+
+#include <string.h>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+
+struct tlvc_converter
+{
+    JsonToTlvConverter               converter;
+    KeySet                           keys;
+    std::string                      error;
+    JsonToTlvConverter::Batch        batch;
+    std::vector<std::string_view>    lines;     // Scratch for tlvc_convert_batch()
+};
+
+namespace
+{
+
+/*  Reads the value of the 'tag' to the 'field' */
+template<class T>
+bool ReadInteger(TLVReader& reader, tlvc_field& field)
+{
+    T value;
+    if (!reader.ReadInteger(value)) {
+        return false;
+    }
+    field.width = sizeof(T);
+    if (std::is_signed<T>::value)
+    {
+        field.type = TLVC_SIGNED;
+        field.integer = value;
+    }
+    else
+    {
+        field.type = TLVC_UNSIGNED;
+        field.unsigned_integer = static_cast<uint64_t>(value);
+    }
+    return true;
+}
+
+bool ReadValue(TLVReader& reader, tlvc_field& field)
+{
+    using Tag = TLVObject::Tag;
+    switch (reader.PeekTag()) {
+        case Tag::Bool_T:
+        case Tag::Bool_F:
+        {
+            bool value;
+            if (!reader.ReadBool(value)) {
+                return false;
+            }
+            field.type = TLVC_BOOL;
+            field.boolean = value;
+            return true;
+        }
+        case Tag::Integer_S8:   return ReadInteger<int8_t>(reader, field);
+        case Tag::Integer_S16:  return ReadInteger<int16_t>(reader, field);
+        case Tag::Integer_S32:  return ReadInteger<int32_t>(reader, field);
+        case Tag::Integer_S64:  return ReadInteger<int64_t>(reader, field);
+        case Tag::Integer_U8:   return ReadInteger<uint8_t>(reader, field);
+        case Tag::Integer_U16:  return ReadInteger<uint16_t>(reader, field);
+        case Tag::Integer_U32:  return ReadInteger<uint32_t>(reader, field);
+        case Tag::Integer_U64:  return ReadInteger<uint64_t>(reader, field);
+        case Tag::String:
+        {
+            std::string_view value;
+            if (!reader.ReadString(value)) {
+                return false;
+            }
+            field.type = TLVC_STRING;
+            field.string = value.data();
+            field.string_size = value.length();
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+/*  Runs the body of the entry point. No C++ exception may unwind into the C caller: running out of memory (bad_alloc and the
+ *  length errors of the containers) gives TLVC_NO_MEMORY, anything else - TLVC_ERROR, the converter's last error tells what */
+template<class Body>
+tlvc_status Guard(tlvc_converter* converter, Body&& body) noexcept
+{
+    tlvc_status status = TLVC_ERROR;
+    const char* error = "unexpected error";
+    try {
+        return body();
+    }
+    catch (const std::bad_alloc&) {
+        status = TLVC_NO_MEMORY;
+        error = "out of memory";
+    }
+    catch (const std::length_error&) {
+        status = TLVC_NO_MEMORY;
+        error = "out of memory";
+    }
+    catch (const std::exception& e) {
+        error = e.what();
+    }
+    catch (...) {
+    }
+    if (converter)
+    {
+        try {
+            converter->error = error;
+        }
+        catch (...) {
+            converter->error.clear();
+        }
+    }
+    return status;
+}
+
+}   // namespace
+
+
+uint32_t tlvc_version(void)
+{
+    return TLVC_VERSION;
+}
+
+tlvc_converter* tlvc_create(void)
+{
+    try {
+        return new tlvc_converter;
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+void tlvc_destroy(tlvc_converter* converter)
+{
+    delete converter;
+}
+
+tlvc_status tlvc_set_dict_format(tlvc_converter* converter, tlvc_dict_format format)
+{
+    return Guard(converter, [&]() -> tlvc_status
+    {
+        if (!converter || (format != TLVC_DICT_TLV && format != TLVC_DICT_INDEXED)) {
+            return TLVC_INVALID_ARGUMENT;
+        }
+        converter->converter.SetDictFormat(format == TLVC_DICT_TLV ? JsonToTlvConverter::DictFormat::TLV
+                                                                   : JsonToTlvConverter::DictFormat::Indexed);
+        return TLVC_OK;
+    });
+}
+
+tlvc_status tlvc_set_keys(tlvc_converter* converter, const char* const* keys, const size_t* key_sizes, size_t count)
+{
+    return Guard(converter, [&]() -> tlvc_status
+    {
+        if (!converter || (count && (!keys || !key_sizes))) {
+            return TLVC_INVALID_ARGUMENT;
+        }
+        if (count == 0)
+        {
+            converter->converter.SetKeySet(nullptr);
+            return TLVC_OK;
+        }
+        std::vector<std::string> list;
+        for (size_t i = 0; i < count; ++i) {
+            list.emplace_back(keys[i], key_sizes[i]);
+        }
+        if (!converter->keys.Build(list))
+        {
+            converter->converter.SetKeySet(nullptr);
+            return TLVC_INVALID_ARGUMENT;
+        }
+        converter->converter.SetKeySet(&converter->keys);
+        return TLVC_OK;
+    });
+}
+
+tlvc_status tlvc_convert(tlvc_converter* converter, const char* json, size_t json_size,
+                         uint8_t* record, size_t record_capacity, size_t* record_size,
+                         uint8_t* dict, size_t dict_capacity, size_t* dict_size)
+{
+    return Guard(converter, [&]() -> tlvc_status
+    {
+        if (!converter || (!json && json_size) || !record_size || !dict_size) {
+            return TLVC_INVALID_ARGUMENT;
+        }
+        JsonToTlvConverter& c = converter->converter;
+        if (!c.Convert(std::string_view(json, json_size)))
+        {
+            converter->error = c.LastError();
+            return TLVC_ERROR;
+        }
+        *record_size = c.Record().Size();
+        *dict_size = c.DictionarySize();
+        if (*record_size > record_capacity || *dict_size > dict_capacity || (!record && *record_size) || (!dict && *dict_size)) {
+            return TLVC_BUFFER_TOO_SMALL;
+        }
+        memcpy(record, c.Record().Data(), *record_size);
+        memcpy(dict, c.DictionaryData(), *dict_size);
+        return TLVC_OK;
+    });
+}
+
+tlvc_status tlvc_convert_batch(tlvc_converter* converter, const char* const* lines, const size_t* line_sizes, size_t count,
+                               uint8_t* out, size_t capacity, size_t* out_size, size_t* offsets)
+{
+    return Guard(converter, [&]() -> tlvc_status
+    {
+        if (!converter || (count && (!lines || !line_sizes)) || !out_size || !offsets) {
+            return TLVC_INVALID_ARGUMENT;
+        }
+        converter->lines.clear();
+        for (size_t i = 0; i < count; ++i) {
+            converter->lines.emplace_back(lines[i], line_sizes[i]);
+        }
+        JsonToTlvConverter::Batch& batch = converter->batch;
+        bool ok = converter->converter.ConvertBatch(converter->lines.data(), count, batch);
+        if (!ok) {
+            converter->error = batch.errors.back().second;
+        }
+
+        memcpy(offsets, batch.offsets.data(), batch.offsets.size() * sizeof(size_t));
+        *out_size = batch.data.size();
+        if (*out_size > capacity || (!out && *out_size)) {
+            return TLVC_BUFFER_TOO_SMALL;
+        }
+        memcpy(out, batch.data.data(), *out_size);
+        return ok ? TLVC_OK : TLVC_ERROR;
+    });
+}
+
+const char* tlvc_last_error(const tlvc_converter* converter)
+{
+    return converter ? converter->error.c_str() : "";
+}
+
+tlvc_status tlvc_decode_record(const uint8_t* record, size_t record_size, tlvc_field* fields, size_t capacity,
+                               size_t* count)
+{
+    return Guard(nullptr, [&]() -> tlvc_status
+    {
+        if ((!record && record_size) || (!fields && capacity) || !count) {
+            return TLVC_INVALID_ARGUMENT;
+        }
+        TLVReader reader(record, record_size);
+        *count = 0;
+        while (!reader.AtEnd())
+        {
+            tlvc_field field = {};
+            if (!reader.ReadInteger(field.key) || !ReadValue(reader, field)) {
+                return TLVC_MALFORMED;
+            }
+            if (*count < capacity) {
+                fields[*count] = field;
+            }
+            ++*count;
+        }
+        return *count > capacity ? TLVC_BUFFER_TOO_SMALL : TLVC_OK;
+    });
+}
+
+tlvc_status tlvc_decode_dict(const uint8_t* dict, size_t dict_size, tlvc_key* keys, size_t capacity, size_t* count)
+{
+    return Guard(nullptr, [&]() -> tlvc_status
+    {
+        if ((!dict && dict_size) || (!keys && capacity) || !count) {
+            return TLVC_INVALID_ARGUMENT;
+        }
+        *count = 0;
+        TLVDictionary indexed(dict, dict_size);
+        if (indexed.Valid())
+        {
+            for (size_t i = 0; i < indexed.Count(); ++i, ++*count)
+            {
+                if (*count < capacity)
+                {
+                    TLVDictionary::Entry entry = indexed.At(i);
+                    keys[*count] = tlvc_key { entry.first.data(), entry.first.length(), entry.second };
+                }
+            }
+        }
+        else
+        {
+            TLVReader reader(dict, dict_size);
+            while (!reader.AtEnd())
+            {
+                std::string_view name;
+                uint8_t id;
+                if (!reader.ReadString(name) || !reader.ReadInteger(id)) {
+                    return TLVC_MALFORMED;
+                }
+                if (*count < capacity) {
+                    keys[*count] = tlvc_key { name.data(), name.length(), id };
+                }
+                ++*count;
+            }
+        }
+        return *count > capacity ? TLVC_BUFFER_TOO_SMALL : TLVC_OK;
+    });
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  ifdef TLVC_BUILD
+#    define TLVC_API __declspec(dllexport)
+#  else
+#    define TLVC_API __declspec(dllimport)
+#  endif
+#else
+#  define TLVC_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*  C ABI of the JSON => TLV conversion (shared library 'tlvconvert') - for the in-process use from any language having the C
+ *  FFI (Go cgo, Python ctypes/cffi...), without spawning JsonToTLV and the temporary files.
+ *
+ *  The ABI is stable: functions are only added, the structures below don't change their layout (TLVC_VERSION grows with the
+ *  additions). Converter handles are not thread-safe - one per thread; the decoding functions have no state. No C++ exception
+ *  leaves the library: a failed allocation gives TLVC_NO_MEMORY (tlvc_create() - NULL), the handle stays usable.
+ *
+ *  tlvc_converter* converter = tlvc_create();
+ *  size_t recordSize, dictSize;
+ *  if (tlvc_convert(converter, json, jsonSize, record, sizeof(record), &recordSize, dict, sizeof(dict), &dictSize) != TLVC_OK)
+ *      puts(tlvc_last_error(converter));
+ *  tlvc_destroy(converter);
+ */
+
+#define TLVC_VERSION 2                  /* 2 - tlvc_convert_batch() */
+
+typedef struct tlvc_converter tlvc_converter;
+
+typedef enum tlvc_status
+{
+    TLVC_OK = 0,
+    TLVC_ERROR = 1,                     /* The line can't be converted - see tlvc_last_error() */
+    TLVC_BUFFER_TOO_SMALL = 2,          /* Output doesn't fit - the required sizes are given back */
+    TLVC_INVALID_ARGUMENT = 3,
+    TLVC_MALFORMED = 4,                 /* Decoded data is not a valid record/dictionary */
+    TLVC_NO_MEMORY = 5                  /* Allocation has failed - the converter may be used on */
+} tlvc_status;
+
+typedef enum tlvc_dict_format
+{
+    TLVC_DICT_TLV = 0,                  /* "name":ID pairs as TLV strings and integers */
+    TLVC_DICT_INDEXED = 1               /* Sorted table, looked up in place (TLVDictionary) */
+} tlvc_dict_format;
+
+typedef enum tlvc_type
+{
+    TLVC_BOOL = 0,
+    TLVC_SIGNED = 1,
+    TLVC_UNSIGNED = 2,
+    TLVC_STRING = 3
+} tlvc_type;
+
+/*  Field of the decoded record */
+typedef struct tlvc_field
+{
+    uint8_t     key;                    /* Key ID - the dictionary has its name */
+    uint8_t     type;                   /* tlvc_type */
+    uint8_t     width;                  /* Bytes the integer was encoded with (1, 2, 4, 8) */
+    uint8_t     boolean;                /* TLVC_BOOL */
+    int64_t     integer;                /* TLVC_SIGNED */
+    uint64_t    unsigned_integer;       /* TLVC_UNSIGNED */
+    const char* string;                 /* TLVC_STRING - points into the record, not terminated */
+    size_t      string_size;
+} tlvc_field;
+
+/*  Entry of the decoded dictionary */
+typedef struct tlvc_key
+{
+    const char* name;                   /* Points into the dictionary, not terminated */
+    size_t      name_size;
+    uint8_t     id;
+} tlvc_key;
+
+/*  Gets TLVC_VERSION the library is built with */
+TLVC_API uint32_t tlvc_version(void);
+
+/*  Creates the converter (NULL if out of memory). It keeps its scratch memory warm between the lines */
+TLVC_API tlvc_converter* tlvc_create(void);
+
+TLVC_API void tlvc_destroy(tlvc_converter* converter);
+
+/*  Sets the form of the dictionaries (TLVC_DICT_TLV by default) */
+TLVC_API tlvc_status tlvc_set_dict_format(tlvc_converter* converter, tlvc_dict_format format);
+
+/*  Makes the 'count' known keys take the fixed IDs 1...count (see KeySet), the other keys of a line are numbered after them.
+ *  'count' = 0 - back to numbering the keys in the line order */
+TLVC_API tlvc_status tlvc_set_keys(tlvc_converter* converter, const char* const* keys, const size_t* key_sizes, size_t count);
+
+/*  Converts one JSON line to the record and dictionary in the caller's memory. Their sizes are put to 'record_size' and
+ *  'dict_size' - also on TLVC_BUFFER_TOO_SMALL, to retry with the big enough buffers */
+TLVC_API tlvc_status tlvc_convert(tlvc_converter* converter, const char* json, size_t json_size,
+                                  uint8_t* record, size_t record_capacity, size_t* record_size,
+                                  uint8_t* dict, size_t dict_capacity, size_t* dict_size);
+
+/*  Converts the 'count' JSON lines ('lines[i]' of 'line_sizes[i]' bytes) to one contiguous buffer 'out': the record and dictionary
+ *  of the 1st line, of the 2nd one... 'offsets' (2 * count + 1 items) get the record and dictionary starts of every line, then
+ *  the end of the data. Lines failed to convert take no bytes - TLVC_ERROR is returned then, tlvc_last_error() tells about the
+ *  last of them. 'out_size' gets the size of the data - also on TLVC_BUFFER_TOO_SMALL (with 'offsets' filled) */
+TLVC_API tlvc_status tlvc_convert_batch(tlvc_converter* converter, const char* const* lines, const size_t* line_sizes, size_t count,
+                                        uint8_t* out, size_t capacity, size_t* out_size, size_t* offsets);
+
+/*  Gets what was wrong with the last line which has failed to convert (valid up to the next call with the converter) */
+TLVC_API const char* tlvc_last_error(const tlvc_converter* converter);
+
+/*  Decodes the record to the 'fields'. The number of fields is put to 'count' - also on TLVC_BUFFER_TOO_SMALL */
+TLVC_API tlvc_status tlvc_decode_record(const uint8_t* record, size_t record_size, tlvc_field* fields, size_t capacity,
+                                        size_t* count);
+
+/*  Decodes the dictionary (either form) to the 'keys'. The number of keys is put to 'count' - also on TLVC_BUFFER_TOO_SMALL */
+TLVC_API tlvc_status tlvc_decode_dict(const uint8_t* dict, size_t dict_size, tlvc_key* keys, size_t capacity, size_t* count);
+
+
+#ifdef __cplusplus
+}
+#endif
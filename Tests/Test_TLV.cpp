@@ -1,15 +1,47 @@
+#include <TLVConvert/TLVConvert.h>
+#include <TLV/TLVDictionary.h>
 #include <TLV/TLVObject.h>
+#include <TLV/TLVReader.h>
+#include <TLV/TLVSchema.h>
+#include <Benchmarks/JsonlGenerator.h>
+#include <JsonToTLV/Arena.h>
+#include <JsonToTLV/BatchConverter.h>
+#include <JsonToTLV/Daemon.h>
+#include <JsonToTLV/DictionaryStore.h>
+#include <JsonToTLV/FlatJsonLexer.h>
+#include <JsonToTLV/JsonStringDecoder.h>
+#include <JsonToTLV/JsonToTlvConverter.h>
+#include <JsonToTLV/KeyHash.h>
+#include <JsonToTLV/KeyMap.h>
+#include <JsonToTLV/KeySet.h>
+#include <JsonToTLV/Options.h>
+#include <JsonToTLV/OutputLayout.h>
+#include <JsonToTLV/OutputWriter.h>
+#include <JsonToTLV/Trace.h>
 #include <JsonToTLV/Utils.h>
+#include <JsonToTLV/WorkStealingPool.h>
 #include <gtest/gtest.h>
 
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <ctime>
+#include <filesystem>
 #include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <thread>
 
 
 // Friendly fixture for access to TLVObject's private fields
 class TLVTester : public ::testing::Test
 {
 public:
-    using Bytes = std::vector<uint8_t>;
+    using Bytes = TLVObject::Bytes;
 
     TLVTester() { tlv2.m_bytes = bytes; }
 
@@ -50,6 +82,21 @@ TEST_F(TLVTester, MoveConstructionAndAssignment)
     tlv2 = std::move(tlv);
     EXPECT_TRUE(tlv.Empty());
     EXPECT_EQ(Tlv2Bytes(), bytes);
+
+    // The peak of the flushed buffer (shrunk since) goes along
+    TLVObject flushing;
+    ASSERT_TRUE(flushing.StartFlushing("move_flushing", 16));
+    memset(flushing.BeginString(100000), 'v', 100000);
+    flushing.EndString(100000);
+    ASSERT_GE(flushing.PeakCapacity(), 100000u);
+    TLVObject moved(std::move(flushing));
+    EXPECT_GE(moved.PeakCapacity(), 100000u);
+    EXPECT_EQ(flushing.PeakCapacity(), 0u);
+    flushing = std::move(moved);
+    EXPECT_GE(flushing.PeakCapacity(), 100000u);
+    EXPECT_EQ(moved.PeakCapacity(), 0u);
+    EXPECT_TRUE(flushing.FinishFlushing());
+    std::remove("move_flushing");
 }
 
 TEST_F(TLVTester, CheckBytesAPI)
@@ -73,10 +120,33 @@ TEST_F(TLVTester, WriteBool)
     EXPECT_EQ( Tlv1Bytes(), expected );
 }
 
-TEST_F(TLVTester, WriteLengthTooBig)
+TEST_F(TLVTester, WriteLength4byte)
+{
+    Bytes expected;
+    EXPECT_TRUE(Tlv1WriteLength(0x1000000));        // Min 4-byte length value is 0x1000000
+    expected = { 0x84, 0x01, 0x00, 0x00, 0x00 };
+    EXPECT_EQ(Tlv1Bytes(), expected);
+    tlv1.Clear();
+
+    EXPECT_TRUE(Tlv1WriteLength(0xFFFFFFFF));       // Max 4-byte length is 0xFFFFFFFF
+    expected = { 0x84, 0xFF, 0xFF, 0xFF, 0xFF };
+    EXPECT_EQ(Tlv1Bytes(), expected);
+}
+
+TEST_F(TLVTester, WriteLength8byte)
 {
-    EXPECT_FALSE( Tlv1WriteLength( 0x1000000 ));    // Next length value after Max
-    EXPECT_TRUE( Tlv1Bytes().empty());
+    if (sizeof(size_t) < 8) {
+        GTEST_SKIP() << "size_t can't keep the lengths above 0xFFFFFFFF";
+    }
+    Bytes expected;
+    EXPECT_TRUE(Tlv1WriteLength(static_cast<size_t>(0x100000000ULL)));     // Min 8-byte length value is 0x100000000
+    expected = { 0x88, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00 };
+    EXPECT_EQ(Tlv1Bytes(), expected);
+    tlv1.Clear();
+
+    EXPECT_TRUE(Tlv1WriteLength(static_cast<size_t>(0x0123456789ABCDEFULL)));
+    expected = { 0x88, 0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF };
+    EXPECT_EQ(Tlv1Bytes(), expected);
 }
 
 TEST_F(TLVTester, WriteLength7bit)
@@ -382,4 +452,1424 @@ TEST_F(ConvertionTester, ConvertIntegers)
         record.clear();
         dict.clear();
     }
-}
\ No newline at end of file
+}
+
+// Check the arena rewinds between the lines instead of growing
+TEST(ArenaTest, ResetReusesBlocks)
+{
+    Arena arena(1024);
+    {
+        Arena::Scope scope(arena);
+        ArenaString str(300, 'x');
+        std::vector<int, ArenaAllocator<int>> ints(100, 7);
+        EXPECT_EQ(&Arena::Current(), &arena);
+        EXPECT_GT(arena.Used(), 0);
+    }
+    EXPECT_EQ(arena.Used(), 0);
+    size_t capacity = arena.Capacity();
+
+    for (int i = 0; i < 100; ++i)
+    {
+        Arena::Scope scope(arena);
+        ArenaString str(300, 'x');
+        std::vector<int, ArenaAllocator<int>> ints(100, 7);
+    }
+    EXPECT_EQ(arena.Capacity(), capacity);
+
+    void* big = arena.Allocate(4096, 8);            // Oversized request gets its own block, freed by Reset()
+    EXPECT_NE(big, nullptr);
+    EXPECT_EQ(arena.Capacity(), capacity + 4096);
+    arena.Reset();
+    EXPECT_EQ(arena.Capacity(), capacity);
+}
+
+// Check the converter reused across the lines gives the same output as fresh conversion
+TEST(ConverterTest, ReuseAcrossLines)
+{
+    using Bytes = std::vector<uint8_t>;
+    JsonToTlvConverter converter;
+
+    EXPECT_TRUE(converter.Convert("{\"key1\":true, \"key2\":\"abc\"}"));
+    EXPECT_EQ(Bytes(converter.Record().Data(), converter.Record().Data() + converter.Record().Size()),
+              (Bytes{ 0x07,0x01,0x01, 0x07,0x02,0x0B,0x03,'a','b','c' }));
+
+    EXPECT_FALSE(converter.Convert("{\"key1\":1.5}"));                    // Floats are not supported
+    EXPECT_FALSE(converter.Convert("{\"key1\":"));                        // Broken JSON
+
+    EXPECT_TRUE(converter.Convert("{\"k\":false}"));
+    EXPECT_EQ(Bytes(converter.Record().Data(), converter.Record().Data() + converter.Record().Size()),
+              (Bytes{ 0x07,0x01,0x02 }));
+    EXPECT_EQ(Bytes(converter.Dictionary().Data(), converter.Dictionary().Data() + converter.Dictionary().Size()),
+              (Bytes{ 0x0B,0x01,'k',0x07,0x01 }));
+}
+
+// Check the string decoding to the TLV buffer - escapes shrink the value, so its Length field may get shorter than reserved
+TEST_F(TLVTester, BeginEndString)
+{
+    uint8_t tag = static_cast<uint8_t>(TLVObject::Tag::String);
+    std::string json(0x40, 'a');
+    json += std::string(0x40, 'b') + "\\n";                              // 0x82 chars, but just 0x81 when decoded
+
+    uint8_t* value = tlv1.BeginString(json.length());
+    ASSERT_NE(value, nullptr);
+    size_t length = 0;
+    EXPECT_TRUE(JsonStringDecoder::Decode(json, value, length));
+    tlv1.EndString(length);
+
+    Bytes expected = { tag, 0x81, 0x81 };
+    expected.insert(expected.end(), 0x40, 'a');
+    expected.insert(expected.end(), 0x40, 'b');
+    expected.push_back('\n');
+    EXPECT_EQ(Tlv1Bytes(), expected);
+    tlv1.Clear();
+
+    json = std::string(0x7C, ' ') + "\\u00e9!";                         // 0x83 chars reserve 2 octets, decoded 0x7F fit in one
+    value = tlv1.BeginString(json.length());
+    EXPECT_TRUE(JsonStringDecoder::Decode(json, value, length));
+    tlv1.EndString(length);
+    expected = { tag, 0x7F };
+    expected.insert(expected.end(), 0x7C, ' ');
+    expected.insert(expected.end(), { 0xC3, 0xA9, '!' });
+    EXPECT_EQ(Tlv1Bytes(), expected);
+    tlv1.Clear();
+
+    // The room for the value is not zero-filled - the buffer kept by Clear() still has the bytes of the last string there
+    value = tlv1.BeginString(json.length());
+    EXPECT_EQ(value[0], ' ');
+    tlv1.EndString(0);
+}
+
+// Check the flat lexer takes the simple lines and declines the rest
+TEST(FlatJsonLexerTest, AcceptsFlatObjectsOnly)
+{
+    Arena::Scope scope(Arena::ThreadLocal());
+    FlatJsonLexer::Fields fields;
+    auto parse = [&fields](std::string_view line) { return FlatJsonLexer::Parse(line, fields); };
+
+    std::string line = " { \"b\" : -0 ,\"a\":\"0123456789abcdefghij\",\"c\":18446744073709551615, \"d\":false }\r";
+    EXPECT_TRUE(parse(line));                                           // Fields are the slices of the 'line'
+    ASSERT_EQ(fields.size(), 4);
+    EXPECT_EQ(fields[0].key, "a");  // Sorted by key like the std::map of nlohmann::json does
+    EXPECT_EQ(fields[0].str, "0123456789abcdefghij");
+    EXPECT_EQ(fields[1].type, FlatJsonLexer::ValueType::Signed);
+    EXPECT_EQ(fields[2].unsignedInteger, UINT64_MAX);
+    EXPECT_FALSE(fields[3].boolean);
+
+    const char* declined[] = {
+        "{}", "{\"a\":1.5}", "{\"a\":1e3}", "{\"a\":01}", "{\"a\":18446744073709551616}", "{\"a\":-9223372036854775809}",
+        "{\"a\":null}", "{\"a\":[1]}", "{\"a\":{\"b\":1}}", "{\"a\":\"x\ny\"}", "{\"a\":1,\"a\":2}",
+        "{\"a\":1,}", "{\"a\":1} x", "{\"a\":tru}", "[1,2]", ""
+    };
+    for (const char* line : declined) {
+        EXPECT_FALSE(parse(line)) << line;
+    }
+}
+
+// Check the fast path gives the same bytes the general parser does
+TEST(ConverterTest, FlatLexerMatchesGeneralParser)
+{
+    using Bytes = std::vector<uint8_t>;
+    JsonToTlvConverter fast, general;
+    general.EnableFlatLexer(false);
+
+    const char* lines[] = {
+        "{\"key1\":true, \"key2\":234,  \"key3\":\"sdfdgv\"}",
+        "{\"zz\":-1, \"aa\":\"\", \"mm\":-40000, \"bb\":4000000000, \"a\":-9223372036854775808}",
+        "{\"k\":\"a long enough string value to cross the sixteen byte SIMD chunks many times\"}",
+        "{\"a\":1,\"a\":2}", "{\"x\":\"esc\\\"aped\"}", "{\"x\":1.5}",
+        "{\"k\\u00e9y\":\"\\\"\\\\\\/\\b\\f\\n\\r\\t\\u0041\\u00E9\\u20AC\\ud83d\\ude00\"}",
+        "{\"\xD0\xBA\xD0\xBB\xD1\x8E\xD1\x87\":\"\xD0\xB7\xD0\xBD\xD0\xB0\xD1\x87\xD0\xB5\xD0\xBD\xD0\xB8\xD0\xB5 \xF0\x9F\x98\x80\"}",
+        "{\"a\":\"\\ud83d\"}", "{\"a\":\"\\ude00\"}", "{\"a\":\"\\x\"}", "{\"a\":\"\\u12G4\"}",
+        "{\"a\":\"\xC0\xAF\"}", "{\"a\":\"\xED\xA0\x80\"}", "{\"a\":\"\xF4\x90\x80\x80\"}", "{\"a\":\"\xE2\x82\"}"
+    };
+    for (const char* line : lines)
+    {
+        bool ok = fast.Convert(line);
+        EXPECT_EQ(ok, general.Convert(line)) << line;
+        if (ok)
+        {
+            EXPECT_EQ(Bytes(fast.Record().Data(), fast.Record().Data() + fast.Record().Size()),
+                      Bytes(general.Record().Data(), general.Record().Data() + general.Record().Size())) << line;
+            EXPECT_EQ(Bytes(fast.Dictionary().Data(), fast.Dictionary().Data() + fast.Dictionary().Size()),
+                      Bytes(general.Dictionary().Data(), general.Dictionary().Data() + general.Dictionary().Size())) << line;
+        }
+    }
+}
+
+// Check the bulk integer encoding gives the same bytes as the one-by-one one, and decodes back
+template<class T>
+void CheckBulkIntegers()
+{
+    for (size_t count : { 0, 1, 7, 16, 33, 100 })
+    {
+        std::vector<T> values(count);
+        for (size_t i = 0; i < count; ++i) {
+            values[i] = static_cast<T>(0x0123456789ABCDEFULL * (i + 1) + i);
+        }
+        TLVObject bulk, single;
+        EXPECT_TRUE(bulk.WriteIntegers(values.data(), count));
+        for (T val : values) {
+            single.WriteInteger(val);
+        }
+        ASSERT_EQ(bulk.Size(), single.Size());
+        EXPECT_EQ(memcmp(bulk.Data(), single.Data(), bulk.Size()), 0) << sizeof(T) << "-byte x" << count;
+
+        std::vector<T> decoded(count);
+        TLVReader reader(bulk.Data(), bulk.Size());
+        EXPECT_TRUE(reader.ReadIntegers(decoded.data(), count));
+        EXPECT_TRUE(reader.AtEnd());
+        EXPECT_EQ(decoded, values);
+    }
+}
+
+TEST(BulkIntegersTest, EncodeDecode)
+{
+    CheckBulkIntegers<int8_t>();
+    CheckBulkIntegers<uint8_t>();
+    CheckBulkIntegers<int16_t>();
+    CheckBulkIntegers<uint16_t>();
+    CheckBulkIntegers<int32_t>();
+    CheckBulkIntegers<uint32_t>();
+    CheckBulkIntegers<int64_t>();
+    CheckBulkIntegers<uint64_t>();
+}
+
+TEST(BulkIntegersTest, DecodeRejectsOtherTags)
+{
+    std::vector<uint32_t> values(40, 0xA58F2301);
+    TLVObject tlv;
+    tlv.WriteIntegers(values.data(), values.size());
+    std::vector<uint8_t> bytes(tlv.Data(), tlv.Data() + tlv.Size());
+    bytes[5 * 21] = static_cast<uint8_t>(TLVObject::Tag::Integer_S32);      // Some item in the middle of the SIMD chunks
+
+    std::vector<uint32_t> decoded(values.size());
+    TLVReader reader(bytes.data(), bytes.size());
+    EXPECT_FALSE(reader.ReadIntegers(decoded.data(), decoded.size()));
+    EXPECT_EQ(reader.Position(), 0);
+    EXPECT_FALSE(reader.ReadIntegers(decoded.data(), decoded.size() + 1));     // More than there is
+}
+
+// Check the reader decodes what TLVObject encodes
+TEST(TLVReaderTest, ReadMixed)
+{
+    TLVObject tlv;
+    std::string longStr(0x1234, 'z');
+    tlv.WriteBool(true);
+    tlv.WriteInteger(int16_t(-300));
+    tlv.WriteString("abc");
+    tlv.WriteString(longStr);
+    tlv.WriteInteger(uint64_t(UINT64_MAX));
+
+    TLVReader reader(tlv.Data(), tlv.Size());
+    bool b = false;
+    int16_t i16 = 0;
+    uint64_t u64 = 0;
+    std::string_view str;
+    EXPECT_FALSE(reader.ReadString(str));                   // Tag mismatch doesn't move the reader
+    EXPECT_TRUE(reader.ReadBool(b));
+    EXPECT_TRUE(b);
+    EXPECT_FALSE(reader.ReadInteger(u64));
+    EXPECT_TRUE(reader.ReadInteger(i16));
+    EXPECT_EQ(i16, -300);
+    EXPECT_TRUE(reader.ReadString(str));
+    EXPECT_EQ(str, "abc");
+    EXPECT_TRUE(reader.ReadString(str));
+    EXPECT_EQ(str, longStr);
+    EXPECT_TRUE(reader.ReadInteger(u64));
+    EXPECT_EQ(u64, UINT64_MAX);
+    EXPECT_TRUE(reader.AtEnd());
+    EXPECT_EQ(reader.PeekTag(), TLVObject::Tag::Invalid);
+
+    TLVReader truncated(tlv.Data(), tlv.Size() - 1);
+    EXPECT_TRUE(truncated.ReadBool(b) && truncated.ReadInteger(i16) && truncated.ReadString(str) && truncated.ReadString(str));
+    EXPECT_FALSE(truncated.ReadInteger(u64));
+}
+
+// Check the struct encoded by the schema is the same as written field by field
+namespace
+{
+struct Sample
+{
+    int32_t     x;
+    bool        visible;
+    uint8_t     level;
+    std::string name;
+};
+
+struct Fixed
+{
+    uint16_t port;
+    bool     enabled;
+};
+
+constexpr auto sampleSchema = MakeTLVSchema<Sample>(MakeTLVField("x", &Sample::x),
+                                                    MakeTLVField("visible", &Sample::visible),
+                                                    MakeTLVField("level", &Sample::level),
+                                                    MakeTLVField("name", &Sample::name));
+
+constexpr auto fixedSchema = MakeTLVSchema<Fixed>(MakeTLVField("port", &Fixed::port), MakeTLVField("enabled", &Fixed::enabled));
+
+static_assert(fixedSchema.IsFixedSize && fixedSchema.FixedSize == 2 + 3 + 2 + 1, "Computed at compile time");
+static_assert(!sampleSchema.IsFixedSize && sampleSchema.FixedSize == 2 + 5 + 2 + 1 + 2 + 2, "Strings are not counted");
+static_assert(sampleSchema.KeyId("level") == 1 && sampleSchema.KeyId("x") == 4 && sampleSchema.KeyId("none") == 0,
+              "Key IDs are resolved at compile time, in the order of the names");
+}
+
+TEST(TLVSchemaTest, EncodeStruct)
+{
+    Sample sample { -70000, true, 200, "Mein Herz Brennt" };
+    TLVObject record, expected;
+    EXPECT_TRUE(sampleSchema.Encode(sample, record));
+    EXPECT_EQ(record.Size(), sampleSchema.EncodedSize(sample));
+
+    expected.WriteInteger(uint8_t(1));
+    expected.WriteInteger(uint8_t(200));
+    expected.WriteInteger(uint8_t(2));
+    expected.WriteString("Mein Herz Brennt");
+    expected.WriteInteger(uint8_t(3));
+    expected.WriteBool(true);
+    expected.WriteInteger(uint8_t(4));
+    expected.WriteInteger(int32_t(-70000));
+    ASSERT_EQ(record.Size(), expected.Size());
+    EXPECT_EQ(memcmp(record.Data(), expected.Data(), record.Size()), 0);
+
+    // The same bytes as the JSON line of the struct gives
+    JsonToTlvConverter converter;
+    ASSERT_TRUE(converter.Convert(R"({"x":-70000,"visible":true,"level":200,"name":"Mein Herz Brennt"})"));
+    EXPECT_EQ(std::vector<uint8_t>(record.Data(), record.Data() + record.Size()),
+              std::vector<uint8_t>(converter.Record().Data(), converter.Record().Data() + converter.Record().Size()));
+    TLVObject sampleDict;
+    EXPECT_TRUE(sampleSchema.EncodeDictionary(sampleDict));
+    EXPECT_EQ(std::vector<uint8_t>(sampleDict.Data(), sampleDict.Data() + sampleDict.Size()),
+              std::vector<uint8_t>(converter.DictionaryData(), converter.DictionaryData() + converter.DictionarySize()));
+
+    TLVObject dict;
+    EXPECT_TRUE(fixedSchema.EncodeDictionary(dict));
+    std::vector<uint8_t> expectedDict = { 0x0B,0x07,'e','n','a','b','l','e','d',0x07,0x01, 0x0B,0x04,'p','o','r','t',0x07,0x02 };
+    EXPECT_EQ(std::vector<uint8_t>(dict.Data(), dict.Data() + dict.Size()), expectedDict);
+
+    TLVObject fixed;
+    EXPECT_TRUE(fixedSchema.Encode(Fixed{ 8080, false }, fixed));
+    EXPECT_EQ(fixed.Size(), fixedSchema.FixedSize);
+}
+
+// Check the huge string value streamed in chunks gets 0x88 Length and decodes back
+TEST_F(TLVTester, WriteStringStream)
+{
+    const size_t total = 0x1000003;                         // Beyond the former 0xFFFFFF limit
+    size_t given = 0;
+    auto source = [&given, total](uint8_t* buffer, size_t capacity)
+    {
+        size_t n = std::min(capacity, total - given);
+        for (size_t i = 0; i < n; ++i) {
+            buffer[i] = static_cast<uint8_t>('a' + (given + i) % 26);
+        }
+        given += n;
+        return n;
+    };
+    EXPECT_TRUE(tlv1.WriteString(source, 1000));
+    EXPECT_TRUE(tlv1.WriteBool(false));
+
+    Bytes header = { static_cast<uint8_t>(TLVObject::Tag::String), 0x88, 0, 0, 0, 0, 0x01, 0x00, 0x00, 0x03 };
+    EXPECT_TRUE(std::equal(header.begin(), header.end(), Tlv1Bytes().begin()));
+    EXPECT_EQ(tlv1.Size(), header.size() + total + 1);
+
+    TLVReader reader(tlv1.Data(), tlv1.Size());
+    std::string_view str;
+    bool b = true;
+    EXPECT_TRUE(reader.ReadString(str));
+    EXPECT_EQ(str.length(), total);
+    EXPECT_EQ(str[total - 1], 'a' + (total - 1) % 26);
+    EXPECT_TRUE(reader.ReadBool(b));
+    EXPECT_FALSE(b);
+
+    tlv1.Clear();                                           // Minimal 0x84 form for the plain string of the same length
+    EXPECT_TRUE(tlv1.WriteString(std::string(total, 'x')));
+    header = { static_cast<uint8_t>(TLVObject::Tag::String), 0x84, 0x01, 0x00, 0x00, 0x03 };
+    EXPECT_TRUE(std::equal(header.begin(), header.end(), Tlv1Bytes().begin()));
+    TLVReader reader2(tlv1.Data(), tlv1.Size());
+    EXPECT_TRUE(reader2.ReadString(str));
+    EXPECT_EQ(str.length(), total);
+}
+
+// Check the flushing mode gives the same bytes as the in-memory one - including the streamed string whose Length has gone to the
+// file before its value was complete
+TEST_F(TLVTester, FlushingMatchesInMemory)
+{
+    const std::string path = "flushing_record";
+    const size_t total = 5000;
+    auto encode = [total](TLVObject& tlv)
+    {
+        size_t given = 0;
+        auto source = [&given, total](uint8_t* buffer, size_t capacity)
+        {
+            size_t n = std::min(capacity, total - given);
+            memset(buffer, 'q', n);
+            given += n;
+            return n;
+        };
+        int32_t values[] = { 1, -2, 300000 };
+        return tlv.WriteInteger(static_cast<uint8_t>(1)) && tlv.WriteString("flushed") && tlv.WriteIntegers(values, 3) &&
+               tlv.WriteString(source, 100) && tlv.WriteBool(true);
+    };
+    EXPECT_TRUE(encode(tlv1));
+
+    EXPECT_TRUE(tlv2.StartFlushing(path, 64));              // 'TEST' bytes it keeps go first
+    EXPECT_TRUE(encode(tlv2));
+    EXPECT_EQ(tlv2.Size(), bytes.size() + tlv1.Size());
+    EXPECT_FALSE(tlv2.Dump(path));                          // The record is in the file already
+    EXPECT_TRUE(tlv2.FinishFlushing());
+    EXPECT_TRUE(tlv2.Empty());
+
+    std::ifstream file(path, std::ios::binary);
+    Bytes flushed((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    std::remove(path.c_str());
+    Bytes expected = bytes;
+    expected.insert(expected.end(), Tlv1Bytes().begin(), Tlv1Bytes().end());
+    EXPECT_TRUE(flushed == expected);
+}
+
+// Check the flushing mode keeps the buffer near the threshold: the huge string goes to the file without being buffered, and the
+// buffer grown by a bulk write is shrunk back after the flush
+TEST_F(TLVTester, FlushingBoundsMemory)
+{
+    const std::string path = "bounded_record";
+    const size_t threshold = 4096;
+    const std::string huge(1024 * 1024, 'h');
+    std::vector<uint32_t> values(100000, 7);
+
+    EXPECT_TRUE(tlv2.StartFlushing(path, threshold));
+    EXPECT_TRUE(tlv2.WriteString(huge));
+    EXPECT_LT(tlv2.PeakCapacity(), 2 * threshold);
+    EXPECT_TRUE(tlv2.WriteIntegers(values.data(), values.size()));
+    EXPECT_LE(Tlv2Bytes().capacity(), threshold);
+    EXPECT_EQ(tlv2.Size(), bytes.size() + TLVObject::StringSize(huge.length()) + values.size() * 5);
+    EXPECT_TRUE(tlv2.FinishFlushing());
+    std::remove(path.c_str());
+}
+
+// Check the huge string values of the line to be flushed are streamed to the file - with the same bytes, but not the whole value
+// in memory - both the plain and escaped ones (cut between the escapes, surrogate pairs and multibyte chars)
+TEST(ConverterTest, FlushingBoundsHugeStrings)
+{
+    std::string plain(300000, 'p');
+    std::string escaped;
+    while (escaped.length() < 300000) {
+        escaped += "ab\\n\\u00e9\\ud83d\\ude00\xC3\xA9\xF0\x9F\x98\x80\\\\\\\"xyz";
+    }
+    const std::string line = "{\"a\":\"" + plain + "\",\"b\":\"" + escaped + "\",\"c\":1}";
+
+    JsonToTlvConverter flushing;
+    flushing.SetFlushThreshold(4096);
+    ASSERT_TRUE(flushing.Convert(line, "bounded_record", "bounded_dict"));
+    EXPECT_LT(flushing.Record().PeakCapacity(), 128u * 1024);
+
+    JsonToTlvConverter converter;
+    ASSERT_TRUE(converter.Convert(line));
+    std::ifstream file("bounded_record", std::ios::binary);
+    std::vector<uint8_t> flushed((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    EXPECT_TRUE(flushed == std::vector<uint8_t>(converter.Record().Data(), converter.Record().Data() + converter.Record().Size()));
+    EXPECT_GT(converter.Record().PeakCapacity(), 500000u);
+
+    EXPECT_FALSE(flushing.Convert("{\"a\":\"" + plain + "\\q\"}", "bounded_record", "bounded_dict"));   // Bad escape is found
+    std::remove("bounded_record");
+    std::remove("bounded_dict");
+}
+
+// Check the files failed to be written fail the line, with and without flushing
+TEST(ConverterTest, ReportsOutputFailures)
+{
+    for (size_t threshold : { 0, 4096 })
+    {
+        JsonToTlvConverter converter;
+        converter.SetFlushThreshold(threshold);
+        if (threshold == 0)
+        {
+            EXPECT_FALSE(converter.Convert(R"({"a":1})", "no_such_dir/record", "failed_dict"));
+            EXPECT_EQ(converter.LastError(), "unable to write the record file");
+        }
+        EXPECT_FALSE(converter.Convert(R"({"a":1})", "failed_record", "no_such_dir/dict"));
+        EXPECT_EQ(converter.LastError(), "unable to write the dictionary file");
+        EXPECT_TRUE(converter.Convert(R"({"a":1})", "failed_record", "failed_dict"));
+    }
+    std::remove("failed_record");
+    std::remove("failed_dict");
+}
+
+// Check both output backends create the files with the given bytes - more files than the io_uring writer has slots
+TEST(OutputWriterTest, WritesFiles)
+{
+    for (bool ioUring : { false, true })
+    {
+        std::unique_ptr<OutputWriter> writer = OutputWriter::Create(ioUring, 4);
+        std::vector<std::vector<uint8_t>> contents;
+        for (size_t i = 0; i < 10; ++i)
+        {
+            contents.emplace_back(i * 100, static_cast<uint8_t>(i));
+            EXPECT_TRUE(writer->Write("output_" + std::to_string(i), contents[i].data(), contents[i].size()));
+        }
+        EXPECT_TRUE(writer->Finish());
+        EXPECT_TRUE(writer->Write("output_0", contents[5].data(), contents[5].size()));     // Truncates the file written before
+        EXPECT_TRUE(writer->Finish());
+        contents[0] = contents[5];
+
+        for (size_t i = 0; i < 10; ++i)
+        {
+            std::string name = "output_" + std::to_string(i);
+            std::ifstream file(name, std::ios::binary);
+            std::vector<uint8_t> written((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            file.close();
+            std::remove(name.c_str());
+            EXPECT_TRUE(written == contents[i]);
+        }
+
+        EXPECT_TRUE(writer->Write("no/such/dir/output", contents[1].data(), contents[1].size()) || !ioUring);
+        EXPECT_FALSE(writer->Finish());
+        EXPECT_TRUE(writer->Finish());                      // Failures are reported once
+    }
+}
+
+// Check the sharded paths: the record and dictionary of a line share the directory, which is created on the first use
+TEST(OutputLayoutTest, ShardedPaths)
+{
+    OutputLayout flat;
+    EXPECT_EQ(flat.Path("record", 7), "record_7");
+
+    OutputLayout numbered("layout_out", 2);
+    EXPECT_EQ(numbered.Path("record", 5), "layout_out/00/00/record_5");
+    EXPECT_EQ(numbered.Path("dict", 300 * OutputLayout::s_linesPerShard + 1), "layout_out/01/2c/dict_307201");
+    EXPECT_TRUE(std::filesystem::is_directory("layout_out/01/2c"));
+    EXPECT_EQ(numbered.Path("record", 0x10203 * OutputLayout::s_linesPerShard),       // Beyond 256^2 shards - no wrap around
+              "layout_out/102/03/record_" + std::to_string(0x10203 * OutputLayout::s_linesPerShard));
+
+    OutputLayout hashed("layout_out/", 1, OutputLayout::Sharding::Hash);
+    std::string record = hashed.Path("record", 12345);
+    std::string dict = hashed.Path("dict", 12345);
+    EXPECT_EQ(record.substr(0, record.rfind('/')), dict.substr(0, dict.rfind('/')));
+    EXPECT_EQ(record.length(), std::string("layout_out/xx/record_12345").length());
+    EXPECT_TRUE(std::filesystem::is_directory(record.substr(0, record.rfind('/'))));
+
+    std::filesystem::remove_all("layout_out");
+    std::ofstream("layout_file").close();                   // Can't have the subdirectories in a file
+    OutputLayout broken("layout_file", 1);
+    EXPECT_TRUE(broken.Path("record", 0).empty());
+    std::remove("layout_file");
+}
+
+// Check the tasks pushed by the tasks are run too, each exactly once
+TEST(WorkStealingPoolTest, RunsNestedTasks)
+{
+    WorkStealingPool pool(4);
+    std::vector<std::atomic<int>> runs(100);
+    for (size_t i = 0; i < 10; ++i)
+    {
+        pool.Push([&pool, &runs, i](size_t) {
+            for (size_t j = 0; j < 10; ++j) {
+                pool.Push([&runs, i, j](size_t worker) { EXPECT_LT(worker, 4u); ++runs[i * 10 + j]; });
+            }
+        });
+    }
+    pool.Run();
+    for (const auto& count : runs) {
+        EXPECT_EQ(count.load(), 1);
+    }
+}
+
+// Check the idle workers sleep while the only task runs - instead of burning the CPU time
+TEST(WorkStealingPoolTest, IdleWorkersSleep)
+{
+    WorkStealingPool pool(4);
+    std::atomic<int> runs { 0 };
+    pool.Push([&pool, &runs](size_t) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        pool.Push([&runs](size_t) { ++runs; });             // Wakes a sleeper
+    });
+    std::clock_t start = std::clock();
+    pool.Run();
+    EXPECT_EQ(runs.load(), 1);
+    EXPECT_LT(static_cast<double>(std::clock() - start) / CLOCKS_PER_SEC, 0.1);
+}
+
+// Check the files split into ranges give every line the same record/dict (and number) the sequential conversion does
+TEST(BatchConverterTest, RangesMatchSequential)
+{
+    namespace fs = std::filesystem;
+    fs::create_directories("batch_in");
+    std::vector<std::string> lines;
+    std::ofstream big("batch_in/big.jsonl", std::ios::binary);
+    for (size_t i = 0; i < 300; ++i)
+    {
+        lines.push_back("{\"id\":" + std::to_string(i) + ",\"name\":\"" + std::string(i % 17, 'x') + "\",\"even\":" +
+                        (i % 2 ? "false" : "true") + "}");
+        big << lines.back() << (i + 1 < 300 ? "\n" : "");  // The last line has no '\n'
+    }
+    big.close();
+    std::ofstream("batch_in/small.jsonl") << lines[0] << "\n" << lines[1] << "\n";
+
+    Options options;
+    options.inputs = { "batch_in" };
+    options.outputDir = "batch_out";
+    options.threads = 3;
+    options.shardLevels = 1;
+    BatchConverter batch(options, 256);
+    EXPECT_TRUE(batch.Run());
+
+    auto read = [](const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    };
+    JsonToTlvConverter converter;
+    for (size_t i = 0; i < lines.size(); ++i)
+    {
+        ASSERT_TRUE(converter.Convert(lines[i]));
+        std::vector<uint8_t> record(converter.Record().Data(), converter.Record().Data() + converter.Record().Size());
+        std::vector<uint8_t> dict(converter.Dictionary().Data(), converter.Dictionary().Data() + converter.Dictionary().Size());
+        EXPECT_TRUE(read("batch_out/big.jsonl/00/record_" + std::to_string(i)) == record);
+        EXPECT_TRUE(read("batch_out/big.jsonl/00/dict_" + std::to_string(i)) == dict);
+        if (i < 2) {
+            EXPECT_TRUE(read("batch_out/small.jsonl/00/record_" + std::to_string(i)) == record);
+        }
+    }
+    EXPECT_FALSE(fs::exists("batch_out/big.jsonl/00/record_300"));
+    EXPECT_FALSE(fs::exists("batch_out/small.jsonl/00/record_2"));
+
+    std::ostringstream printed;                             // Nothing is counted without Options::stats
+    batch.PrintStats(printed);
+    for (size_t i = 0; i < options.threads; ++i) {
+        EXPECT_NE(printed.str().find("#" + std::to_string(i) + "\tlines: 0\trecords: 0\tbytes in: 0\t"), std::string::npos);
+    }
+    fs::remove_all("batch_in");
+    fs::remove_all("batch_out");
+}
+
+// Check the record sizes and Tags are counted per record, and the per-thread counters add up
+TEST(ConversionStatsTest, CountsRecords)
+{
+    ConversionStats stats;
+    JsonToTlvConverter converter;
+    converter.SetStats(&stats);
+    EXPECT_TRUE(converter.Convert(R"({"a":1,"b":"xy","c":true,"d":-300})", "stats_record", "stats_dict"));
+    std::remove("stats_record");
+    std::remove("stats_dict");
+
+    size_t recordSize = 4 * 2 + 2 + 4 + 1 + 3;
+    EXPECT_EQ(stats.records, 1u);
+    EXPECT_EQ(stats.bytesOut, recordSize + converter.Dictionary().Size());
+    EXPECT_EQ(stats.recordSizes[5], 1u);                    // [16, 32)
+    EXPECT_EQ(stats.tags[static_cast<uint8_t>(TLVObject::Tag::Integer_U8)], 5u);     // 4 key IDs and 1
+    EXPECT_EQ(stats.tags[static_cast<uint8_t>(TLVObject::Tag::Integer_S16)], 1u);
+    EXPECT_EQ(stats.tags[static_cast<uint8_t>(TLVObject::Tag::String)], 1u);
+    EXPECT_EQ(stats.tags[static_cast<uint8_t>(TLVObject::Tag::Bool_T)], 1u);
+
+    ConversionStats total;
+    total.Merge(stats);
+    total.Merge(stats);
+    EXPECT_EQ(total.records, 2u);
+    EXPECT_EQ(total.tags[static_cast<uint8_t>(TLVObject::Tag::Integer_U8)], 10u);
+}
+
+// Check the failed lines go to the rejects file with their numbers and reasons, and the rest of the lines are converted
+TEST(BatchConverterTest, RejectsBadLines)
+{
+    namespace fs = std::filesystem;
+    std::ofstream("rejects_in.jsonl") << "{\"a\":1}\n{\"a\":1.5}\n\n{\"a\":{\"b\":1}}\n{\"a\":2}\n";
+
+    Options options;
+    options.inputs = { "rejects_in.jsonl" };
+    options.outputDir = "rejects_out";
+    options.rejectsFile = "rejects.txt";
+    options.threads = 1;
+    BatchConverter batch(options);
+    EXPECT_TRUE(batch.Run());
+    EXPECT_EQ(batch.Rejected(), 3u);
+    EXPECT_TRUE(fs::exists("rejects_out/record_0"));
+    EXPECT_FALSE(fs::exists("rejects_out/record_1"));
+    EXPECT_TRUE(fs::exists("rejects_out/record_4"));
+
+    std::ifstream rejects("rejects.txt");
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(rejects, line); ) {
+        lines.push_back(line);
+    }
+    rejects.close();
+    ASSERT_EQ(lines.size(), 3u);
+    EXPECT_EQ(lines[0], "rejects_in.jsonl:1\tfloating point value of the key 'a'\t{\"a\":1.5}");
+    EXPECT_EQ(lines[1].rfind("rejects_in.jsonl:2\t[json.exception.parse_error", 0), 0u);
+    EXPECT_EQ(lines[2], "rejects_in.jsonl:3\tnested value of the key 'a'\t{\"a\":{\"b\":1}}");
+
+    options.rejectsFile.clear();                            // Without rejects the bad line stops the conversion
+    fs::remove_all("rejects_out");
+    BatchConverter stopping(options);
+    EXPECT_FALSE(stopping.Run());
+    EXPECT_TRUE(fs::exists("rejects_out/record_0"));
+    EXPECT_FALSE(fs::exists("rejects_out/record_4"));
+
+    fs::remove_all("rejects_out");
+    std::remove("rejects_in.jsonl");
+    std::remove("rejects.txt");
+}
+
+#ifdef JSONTOTLV_TRACE
+// Check the spans of the conversion are exported as Chrome trace events
+TEST(TraceTest, ExportsSpans)
+{
+    JsonToTlvConverter converter;
+    EXPECT_TRUE(converter.Convert(R"({"a":1})", "trace_record", "trace_dict"));
+    std::remove("trace_record");
+    std::remove("trace_dict");
+    {
+        TRACE_SPAN("test span");
+    }
+    EXPECT_TRUE(Trace::Export("trace.json"));
+
+    std::ifstream file("trace.json");
+    std::string trace((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    std::remove("trace.json");
+    EXPECT_EQ(trace.rfind("{\"traceEvents\":[", 0), 0u);
+    EXPECT_NE(trace.find("\"name\":\"test span\",\"ph\":\"X\""), std::string::npos);
+    EXPECT_NE(trace.find("\"name\":\"dump\""), std::string::npos);
+}
+
+// Check the thread's buffer keeps its latest spans only and the dropped ones are counted
+TEST(TraceTest, DropsOldestSpans)
+{
+    Trace::SetCapacity(4);
+    std::thread thread([]
+    {
+        static const char* names[] = { "span 0", "span 1", "span 2", "span 3", "span 4", "span 5", "span 6", "span 7" };
+        for (const char* name : names) {
+            Trace::Record(name, 0, 1);
+        }
+    });
+    thread.join();
+    Trace::SetCapacity(Trace::s_defaultCapacity);
+    EXPECT_TRUE(Trace::Export("trace.json"));
+
+    std::ifstream file("trace.json");
+    std::string trace((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    std::remove("trace.json");
+    EXPECT_EQ(trace.find("\"span 3\""), std::string::npos);
+    EXPECT_LT(trace.find("\"span 4\""), trace.find("\"span 7\""));                   // Oldest first
+    EXPECT_NE(trace.find("\"otherData\":{\"droppedEvents\":4}"), std::string::npos);
+}
+#endif
+
+// Check the generator is deterministic, its lines convert and the value classes give the Tags and Length forms they stand for
+TEST(JsonlGeneratorTest, SeededLinesConvert)
+{
+    JsonlGenerator::Settings settings;
+    settings.keysPerObject = 5;
+    settings.keyCardinality = 7;
+    settings.repeatRate = 0.25;
+    settings.seed = 42;
+    for (uint32_t& weight : settings.mix) {
+        weight = 1;
+    }
+    JsonlGenerator first(settings), second(settings);
+    JsonToTlvConverter converter;
+    size_t tags[256] = {};
+    bool widest = false;
+
+    for (size_t i = 0; i < 300; ++i)
+    {
+        std::string line = first.Next();
+        ASSERT_EQ(line, second.Next());
+        ASSERT_TRUE(converter.Convert(line)) << line;
+        EXPECT_EQ(converter.Dictionary().Size(), 5u * (4 + 2));           // "kN" - Tag, Length, 2 chars; ID - Tag, byte
+        TLVReader reader(converter.Record().Data(), converter.Record().Size());
+        while (!reader.AtEnd())
+        {
+            if (reader.PeekTag() == TLVObject::Tag::String && converter.Record().Data()[reader.Position() + 1] == 0x83) {
+                widest = true;
+            }
+            ++tags[static_cast<uint8_t>(reader.PeekTag())];
+            ASSERT_TRUE(reader.Skip());
+        }
+    }
+    for (uint8_t tag = static_cast<uint8_t>(TLVObject::Tag::Bool_T); tag < static_cast<uint8_t>(TLVObject::Tag::Invalid); ++tag) {
+        EXPECT_GT(tags[tag], 0u) << int(tag);
+    }
+    EXPECT_TRUE(widest);
+
+    JsonlGenerator seeded42(settings);
+    settings.seed = 43;
+    EXPECT_NE(JsonlGenerator(settings).Next(), seeded42.Next());                  // Only the seed differs
+}
+
+// Check the extreme repeat rates: 0 - every line is new, 1 - every line after the first one is a repeat
+TEST(JsonlGeneratorTest, RepeatRateBounds)
+{
+    JsonlGenerator::Settings settings;
+    for (double rate : { 0.0, 1.0 })
+    {
+        settings.repeatRate = rate;
+        JsonlGenerator generator(settings);
+        std::set<std::string> unique;
+        for (size_t i = 0; i < 500; ++i) {
+            unique.insert(generator.Next());
+        }
+        EXPECT_EQ(unique.size(), rate == 0 ? 500u : 1u) << rate;
+    }
+}
+
+TEST(TLVDictionaryTest, LookupByNameAndId)
+{
+    std::vector<TLVDictionary::Entry> entries = { { "qwe", 2 }, { "key1", 1 }, { "keyEE", 3 }, { "a", 5 } };
+    std::vector<uint8_t> data;
+    ASSERT_TRUE(TLVDictionary::Build(entries, data));
+
+    TLVDictionary dict(data.data(), data.size());
+    ASSERT_TRUE(dict.Valid());
+    EXPECT_EQ(dict.Count(), 4u);
+    EXPECT_EQ(dict.Find("key1"), 1);
+    EXPECT_EQ(dict.Find("keyEE"), 3);
+    EXPECT_EQ(dict.Find("a"), 5);
+    EXPECT_EQ(dict.Find("key"), 0);
+    EXPECT_EQ(dict.Find("zzz"), 0);
+    EXPECT_EQ(dict.Name(2), "qwe");
+    EXPECT_EQ(dict.Name(4), "");
+    EXPECT_EQ(dict.Name(200), "");
+    EXPECT_EQ(dict.At(0).first, "a");                       // Sorted by name
+    EXPECT_EQ(dict.At(3).first, "qwe");
+
+    std::vector<TLVDictionary::Entry> duplicates = { { "a", 1 }, { "a", 2 } };
+    EXPECT_FALSE(TLVDictionary::Build(duplicates, data));
+
+    data[4] = TLVDictionary::s_version + 1;
+    EXPECT_FALSE(TLVDictionary(data.data(), data.size()).Valid());
+    EXPECT_FALSE(TLVDictionary(data.data(), TLVDictionary::s_headerSize - 1).Valid());
+}
+
+TEST(ConverterTest, IndexedDictionary)
+{
+    JsonToTlvConverter converter;
+    converter.SetDictFormat(JsonToTlvConverter::DictFormat::Indexed);
+    ASSERT_TRUE(converter.Convert(R"({"b":1,"a":"xy","c":true})"));
+    EXPECT_EQ(converter.Dictionary().Size(), 0u);
+
+    const std::vector<uint8_t>& data = converter.IndexedDictionary();
+    TLVDictionary dict(data.data(), data.size());
+    ASSERT_TRUE(dict.Valid());
+    EXPECT_EQ(dict.Count(), 3u);
+    EXPECT_EQ(dict.Find("a"), 1);
+    EXPECT_EQ(dict.Find("b"), 2);
+    EXPECT_EQ(dict.Name(3), "c");
+}
+
+// Check the hash values are fixed - the deduplicated dictionary files are named by them, so they must not change from machine to
+// machine (byte order) or from build to build
+TEST(KeyHashTest, StableValues)
+{
+    EXPECT_EQ(KeyHash::Hash(""), 0x42BC986DC5EEC4D3ULL);
+    EXPECT_EQ(KeyHash::Hash("ab"), 0x172BA773B8EBB6D8ULL);
+    EXPECT_EQ(KeyHash::Hash("keys"), 0x9883A36711F5F9F5ULL);
+    EXPECT_EQ(KeyHash::Hash("a_key_of_20_bytes_xx"), 0xF1585EDE39A93426ULL);
+    EXPECT_EQ(KeyHash::Hash("a longer key of more than thirty-two bytes"), 0xE4265A6BBDD33210ULL);
+}
+
+TEST(KeySetTest, PerfectHashLookup)
+{
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < KeySet::s_maxKeys; ++i) {
+        keys.push_back("key" + std::to_string(i));
+    }
+    KeySet set;
+    ASSERT_TRUE(set.Build(keys));
+    for (size_t i = 0; i < keys.size(); ++i) {
+        EXPECT_EQ(set.Find(keys[i]), i + 1);
+    }
+    EXPECT_EQ(set.Find("key"), 0);
+    EXPECT_EQ(set.Find("key" + std::to_string(KeySet::s_maxKeys)), 0);
+    EXPECT_EQ(set.Key(3), "key2");
+
+    keys.push_back("one more");
+    EXPECT_FALSE(set.Build(keys));
+    EXPECT_FALSE(set.Build({ "a", "b", "a" }));
+    ASSERT_TRUE(set.Build({}));
+    EXPECT_EQ(set.Find("a"), 0);
+}
+
+TEST(ConverterTest, KnownKeysTakeFixedIds)
+{
+    KeySet keys;
+    ASSERT_TRUE(keys.Build({ "z", "b" }));
+    JsonToTlvConverter converter;
+    converter.SetKeySet(&keys);
+
+    // Flat lexer and general parser ("x" is duplicated) give the same: "b" - 2, "z" - 1, unknown "x" - 3
+    for (const char* line : { R"({"z":1,"x":true,"b":2})", R"({"z":1,"x":false,"x":true,"b":2})" })
+    {
+        ASSERT_TRUE(converter.Convert(line));
+        std::vector<uint8_t> record = { 0x07, 2, 0x07, 2, 0x07, 3, 0x01, 0x07, 1, 0x07, 1 };   // "b":2, "x":true, "z":1
+        EXPECT_EQ(std::vector<uint8_t>(converter.Record().Data(), converter.Record().Data() + converter.Record().Size()),
+                  record);
+
+        std::vector<std::pair<std::string, uint8_t>> dict;
+        TLVReader reader(converter.Dictionary().Data(), converter.Dictionary().Size());
+        std::string_view name;
+        uint8_t id;
+        while (reader.ReadString(name) && reader.ReadInteger(id)) {
+            dict.emplace_back(std::string(name), id);
+        }
+        std::sort(dict.begin(), dict.end());
+        EXPECT_EQ(dict, (std::vector<std::pair<std::string, uint8_t>> { { "b", 2 }, { "x", 3 }, { "z", 1 } }));
+    }
+}
+
+// Check the key set sampled from the lines with too many keys leaves the IDs for the keys met later
+TEST(KeySetTest, SampleLeavesIdsForUnknownKeys)
+{
+    std::ofstream sample("keys_sample.jsonl");
+    for (size_t line = 0; line < 3; ++line)
+    {
+        std::string json = "{";
+        for (size_t i = 0; i < 100; ++i) {
+            json += std::string(i ? "," : "") + "\"k" + std::to_string(line * 100 + i) + "\":1";
+        }
+        sample << json << "}\n";
+    }
+    sample.close();
+    std::vector<std::string> sampled;
+    ASSERT_TRUE(KeySet::Sample("keys_sample.jsonl", 10, sampled));
+    std::remove("keys_sample.jsonl");
+    EXPECT_EQ(sampled.size(), KeySet::s_maxKeys);
+
+    KeySet keys;
+    ASSERT_TRUE(keys.Build(sampled));
+    JsonToTlvConverter converter;
+    converter.SetKeySet(&keys);
+    std::string json = "{\"k0\":1";
+    for (size_t i = 0; i < KeySet::s_reservedIds; ++i) {
+        json += ",\"new" + std::to_string(i) + "\":2";
+    }
+    EXPECT_TRUE(converter.Convert(json + "}"));
+    EXPECT_FALSE(converter.Convert(json + ",\"one more\":3}"));
+    EXPECT_EQ(converter.LastError(), "too many keys");
+}
+
+// Friendly fixture for access to KeyMap's table
+class KeyMapTester : public ::testing::Test
+{
+public:
+    struct Placement
+    {
+        size_t evenSlots = 0;       // Entries taking the even slots
+        size_t displacement = 0;    // Steps from the home slots, all the entries together
+    };
+
+    Placement Place(const KeyMap& map) const
+    {
+        Placement placement;
+        for (size_t slot = 0; slot < map.m_table.size(); ++slot)
+        {
+            if (!map.m_table[slot].tag) {
+                continue;
+            }
+            std::string_view key = map.m_entries[map.m_table[slot].entry].Key();
+            placement.evenSlots += slot % 2 == 0;
+            placement.displacement += (slot - (KeyHash::Hash(key) & map.m_mask)) & map.m_mask;
+        }
+        return placement;
+    }
+
+    size_t Slots(const KeyMap& map) const   { return map.m_table.size(); }
+};
+
+// Check the keys start probing from any slot, not half of them - the runs stay short at the table's highest load
+TEST_F(KeyMapTester, ShortProbeRuns)
+{
+    KeyMap map;
+    const size_t count = 256;                               // Half of the 512 slots
+    for (size_t i = 0; i < count; ++i) {
+        map.Set("key" + std::to_string(i), static_cast<uint8_t>(i));
+    }
+    ASSERT_EQ(Slots(map), 2 * count);
+
+    Placement placement = Place(map);
+    EXPECT_GT(placement.evenSlots, count * 2 / 5);
+    EXPECT_LT(placement.evenSlots, count * 3 / 5);
+    EXPECT_LT(placement.displacement, count);               // Under one step per key on average
+}
+
+TEST(KeyMapTest, ReusedAcrossLines)
+{
+    KeyMap map;
+    std::string longKey(100, 'k');
+    for (int line = 0; line < 3; ++line)
+    {
+        map.Clear();
+        EXPECT_TRUE(map.Empty());
+        for (int i = 1; i <= 200; ++i) {                        // Grows the table a few times
+            map.Set("key" + std::to_string(i + line), static_cast<uint8_t>(i));
+        }
+        map.Set(longKey, 201);
+        map.Set("key" + std::to_string(1 + line), 202);         // Replaces the ID
+        EXPECT_EQ(map.Size(), 201u);
+        EXPECT_EQ(map.Find("key" + std::to_string(2 + line)), 2);
+        EXPECT_EQ(map.Find("key" + std::to_string(1 + line)), 202);
+        EXPECT_EQ(map.Find(longKey), 201);
+        EXPECT_EQ(map.Find("key0"), 0);
+
+        uint8_t expected = 1;
+        for (const KeyMap::Entry& entry : map)                  // Insertion order
+        {
+            if (expected == 1) {
+                EXPECT_EQ(entry.Id(), 202);
+            }
+            else if (expected == 201) {
+                EXPECT_EQ(entry.Key(), longKey);
+            }
+            else {
+                EXPECT_EQ(entry.Id(), expected);
+            }
+            ++expected;
+        }
+    }
+}
+
+TEST(BatchConverterTest, DedupesDictionaries)
+{
+    namespace fs = std::filesystem;
+    std::ofstream("dedupe_in.jsonl") << "{\"a\":1,\"b\":true}\n{\"b\":false,\"a\":7}\n{\"c\":\"x\"}\n{\"a\":2,\"b\":true}\n";
+
+    Options options;
+    options.inputs = { "dedupe_in.jsonl" };
+    options.outputDir = "dedupe_out";
+    options.dedupeDicts = true;
+    options.threads = 1;
+    BatchConverter batch(options);
+    EXPECT_TRUE(batch.Run());
+
+    std::vector<std::string> dicts;
+    for (const auto& entry : fs::directory_iterator("dedupe_out"))
+    {
+        std::string name = entry.path().filename().string();
+        if (name.rfind("dict_", 0) == 0 && name != DictionaryStore::s_indexName) {
+            dicts.push_back(name);
+        }
+    }
+    EXPECT_EQ(dicts.size(), 2u);                            // {"a", "b"} and {"c"}
+    EXPECT_TRUE(fs::exists("dedupe_out/record_3"));
+    EXPECT_FALSE(fs::exists("dedupe_out/dict_0"));
+
+    std::ifstream index(std::string("dedupe_out/") + DictionaryStore::s_indexName);
+    std::map<std::string, std::string> refs;
+    for (std::string number, name; index >> number >> name; ) {
+        refs[number] = name;
+    }
+    index.close();
+    ASSERT_EQ(refs.size(), 4u);
+    EXPECT_EQ(refs["0"], refs["1"]);                        // Key order of the line doesn't matter
+    EXPECT_EQ(refs["0"], refs["3"]);
+    EXPECT_NE(refs["0"], refs["2"]);
+
+    JsonToTlvConverter converter;                           // The stored dictionary is what the line gives
+    ASSERT_TRUE(converter.Convert("{\"c\":\"x\"}"));
+    std::ifstream dict("dedupe_out/" + refs["2"], std::ios::binary);
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(dict)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(bytes, std::vector<uint8_t>(converter.DictionaryData(), converter.DictionaryData() + converter.DictionarySize()));
+    dict.close();
+
+    fs::remove_all("dedupe_out");
+    std::remove("dedupe_in.jsonl");
+}
+
+// Check the manifest covers every line once and its segment chunk gives the record/dict the line converts to
+TEST(BatchConverterTest, SegmentsMatchSequential)
+{
+    namespace fs = std::filesystem;
+    std::vector<std::string> lines;
+    std::ofstream input("segments_in.jsonl", std::ios::binary);
+    for (size_t i = 0; i < 200; ++i)
+    {
+        lines.push_back(i == 123 ? "{\"a\":1.5}" : "{\"id\":" + std::to_string(i) + ",\"s\":\"" + std::string(i % 13, 'x') + "\"}");
+        input << lines.back() << "\n";
+    }
+    input.close();
+
+    Options options;
+    options.inputs = { "segments_in.jsonl" };
+    options.outputDir = "segments_out";
+    options.rejectsFile = "segments_rejects.txt";
+    options.segments = true;
+    options.threads = 3;
+    BatchConverter batch(options, 256);
+    EXPECT_TRUE(batch.Run());
+    EXPECT_EQ(batch.Rejected(), 1u);
+    EXPECT_FALSE(fs::exists("segments_out/record_0"));
+
+    auto get64 = [](const std::vector<uint8_t>& bytes, size_t pos)
+    {
+        uint64_t val = 0;
+        for (size_t b = 0; b < 8; ++b) {
+            val |= static_cast<uint64_t>(bytes[pos + b]) << (8 * b);
+        }
+        return val;
+    };
+    std::ifstream manifest(std::string("segments_out/") + BatchConverter::s_manifestName);
+    JsonToTlvConverter converter;
+    uint64_t next = 0;
+    std::string path, segment;
+    uint64_t firstLine, count, offset, size;
+    while (manifest >> path >> firstLine >> count >> segment >> offset >> size)
+    {
+        EXPECT_EQ(path, "segments_in.jsonl");
+        EXPECT_EQ(firstLine, next);                         // Sorted, no gaps
+        std::ifstream file("segments_out/" + segment, std::ios::binary);
+        std::vector<uint8_t> chunk(size);
+        file.seekg(static_cast<std::streamoff>(offset));
+        file.read(reinterpret_cast<char*>(chunk.data()), size);
+        ASSERT_EQ(static_cast<uint64_t>(file.gcount()), size);
+
+        size_t data = (2 * count + 1) * 8;
+        EXPECT_EQ(data + get64(chunk, 2 * count * 8), size);
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            uint64_t record = get64(chunk, 2 * i * 8), dict = get64(chunk, (2 * i + 1) * 8), end = get64(chunk, (2 * i + 2) * 8);
+            if (firstLine + i == 123)
+            {
+                EXPECT_EQ(record, end);                     // Rejected line is empty
+                continue;
+            }
+            ASSERT_TRUE(converter.Convert(lines[firstLine + i]));
+            EXPECT_EQ(std::vector<uint8_t>(chunk.begin() + data + record, chunk.begin() + data + dict),
+                      std::vector<uint8_t>(converter.Record().Data(), converter.Record().Data() + converter.Record().Size()));
+            EXPECT_EQ(std::vector<uint8_t>(chunk.begin() + data + dict, chunk.begin() + data + end),
+                      std::vector<uint8_t>(converter.DictionaryData(), converter.DictionaryData() + converter.DictionarySize()));
+        }
+        next = firstLine + count;
+    }
+    EXPECT_EQ(next, lines.size());
+    manifest.close();
+
+    fs::remove_all("segments_out");
+    std::remove("segments_in.jsonl");
+    std::remove("segments_rejects.txt");
+}
+
+// Check --segments and --serve are refused with the options they don't honour
+TEST(OptionsTest, RejectsUnhonouredOptions)
+{
+    auto parse = [](std::vector<const char*> args)
+    {
+        Options options;
+        args.insert(args.begin(), "JsonToTLV");
+        return ParseOptions(static_cast<int>(args.size()), const_cast<char**>(args.data()), options);
+    };
+    EXPECT_TRUE(parse({ "--segments", "--threads", "2", "in.jsonl" }));
+    EXPECT_FALSE(parse({ "--segments", "--flush-threshold", "4096", "in.jsonl" }));
+    EXPECT_FALSE(parse({ "--segments", "--io-uring", "in.jsonl" }));
+    EXPECT_FALSE(parse({ "--shard-levels", "2", "--segments", "in.jsonl" }));
+    EXPECT_FALSE(parse({ "--shards", "in.jsonl" }));
+
+    // The daemon honours the output directory, and refuses what it has no use for
+    EXPECT_TRUE(parse({ "--serve", "x.sock", "--output-dir", "out" }));
+    for (const char* option : { "--dedupe-dicts", "--stats" }) {
+        EXPECT_FALSE(parse({ "--serve", "x.sock", option })) << option;
+    }
+    EXPECT_FALSE(parse({ "--serve", "x.sock", "--rejects", "rejects.txt" }));
+}
+
+// Check the line is not indexed when its new dictionary can't be written - and the next line having it tries again
+TEST(DictionaryStoreTest, IndexesWrittenDictionariesOnly)
+{
+    namespace fs = std::filesystem;
+    const uint8_t dict[] = { 0x0B, 0x01, 'a', 0x07, 0x01 };
+    bool isNew = false;
+    DictionaryStore probe("store_probe");
+    ASSERT_TRUE(probe.Open());
+    ASSERT_TRUE(probe.Reference(0, dict, sizeof(dict), isNew));
+    std::string name;
+    for (const auto& entry : fs::directory_iterator("store_probe"))
+    {
+        if (entry.path().filename() != DictionaryStore::s_indexName) {
+            name = entry.path().filename().string();
+        }
+    }
+    probe.Close();
+    fs::remove_all("store_probe");
+
+    DictionaryStore store("store_out");
+    ASSERT_TRUE(store.Open());
+    fs::create_directories("store_out/" + name);           // The file can't be created in place of the directory
+    EXPECT_FALSE(store.Reference(5, dict, sizeof(dict), isNew));
+    EXPECT_EQ(store.Distinct(), 0u);
+    fs::remove("store_out/" + name);
+    EXPECT_TRUE(store.Reference(6, dict, sizeof(dict), isNew));
+    EXPECT_TRUE(isNew);
+    EXPECT_TRUE(store.Close());
+
+    std::ifstream index(std::string("store_out/") + DictionaryStore::s_indexName);
+    std::string line;
+    std::getline(index, line);
+    EXPECT_EQ(line, "6\t" + name);
+    EXPECT_FALSE(std::getline(index, line));
+    index.close();
+    fs::remove_all("store_out");
+}
+
+TEST(DaemonTest, AnswersPipelinedRequests)
+{
+    namespace fs = std::filesystem;
+    std::ofstream("daemon_in.jsonl") << "{\"a\":1}\n{\"b\":true}\n";
+
+    Options options;
+    options.outputDir = "daemon_default";
+    Daemon daemon("daemon.sock", options);
+    ASSERT_TRUE(daemon.Listen());
+    std::thread server([&daemon] { daemon.Serve(); });
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, "daemon.sock");
+    ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+
+    // Three requests at once, the answers come in the same order
+    std::vector<uint8_t> requests;
+    auto request = [&requests](uint8_t type, const std::string& payload)
+    {
+        requests.push_back(type);
+        for (size_t i = 0; i < 4; ++i) {
+            requests.push_back(static_cast<uint8_t>(payload.size() >> (8 * i)));
+        }
+        requests.insert(requests.end(), payload.begin(), payload.end());
+    };
+    request(Daemon::ConvertJson, R"({"x":5,"y":"z"})");
+    request(Daemon::ConvertJson, R"({"x":1.5})");
+    request(Daemon::ConvertFile, std::string("daemon_in.jsonl\0daemon_out", 26));
+    request(Daemon::ConvertFile, "daemon_in.jsonl");                        // To the daemon's output directory
+    ASSERT_EQ(send(fd, requests.data(), requests.size(), 0), static_cast<ssize_t>(requests.size()));
+
+    auto receive = [fd](size_t size)
+    {
+        std::vector<uint8_t> data(size);
+        for (size_t got = 0; got < size; )
+        {
+            ssize_t n = recv(fd, data.data() + got, size - got, 0);
+            if (n <= 0) {
+                return std::vector<uint8_t>();
+            }
+            got += static_cast<size_t>(n);
+        }
+        return data;
+    };
+    auto answer = [&receive](uint8_t& status)
+    {
+        std::vector<uint8_t> header = receive(5);
+        if (header.size() != 5) {
+            return header;
+        }
+        status = header[0];
+        return receive(header[1] | (header[2] << 8) | (header[3] << 16) | (static_cast<size_t>(header[4]) << 24));
+    };
+
+    JsonToTlvConverter converter;
+    ASSERT_TRUE(converter.Convert(R"({"x":5,"y":"z"})"));
+    uint8_t status = 0xFF;
+    std::vector<uint8_t> payload = answer(status);
+    EXPECT_EQ(status, Daemon::Ok);
+    ASSERT_GE(payload.size(), 4u);
+    size_t recordSize = payload[0] | (payload[1] << 8);
+    EXPECT_EQ(std::vector<uint8_t>(payload.begin() + 4, payload.begin() + 4 + recordSize),
+              std::vector<uint8_t>(converter.Record().Data(), converter.Record().Data() + converter.Record().Size()));
+    EXPECT_EQ(std::vector<uint8_t>(payload.begin() + 4 + recordSize, payload.end()),
+              std::vector<uint8_t>(converter.DictionaryData(), converter.DictionaryData() + converter.DictionarySize()));
+
+    payload = answer(status);
+    EXPECT_EQ(status, Daemon::Failed);
+    EXPECT_EQ(std::string(payload.begin(), payload.end()), "floating point value of the key 'x'");
+
+    payload = answer(status);
+    EXPECT_EQ(status, Daemon::Ok);
+    ASSERT_EQ(payload.size(), 8u);
+    EXPECT_EQ(payload[0], 2);                               // Lines converted
+    EXPECT_TRUE(fs::exists("daemon_out/record_1"));
+    EXPECT_TRUE(fs::exists("daemon_out/dict_1"));
+
+    payload = answer(status);
+    EXPECT_EQ(status, Daemon::Ok);
+    EXPECT_TRUE(fs::exists("daemon_default/record_1"));
+
+    close(fd);
+    daemon.Stop();
+    server.join();
+    fs::remove_all("daemon_out");
+    fs::remove_all("daemon_default");
+    std::remove("daemon_in.jsonl");
+}
+
+// Check the daemon serves no more connections at once than it has workers - the next one waits for a free worker
+TEST(DaemonTest, BoundsConnections)
+{
+    Options options;
+    options.threads = 1;
+    Daemon daemon("daemon.sock", options);
+    ASSERT_TRUE(daemon.Listen());
+    std::thread server([&daemon] { daemon.Serve(); });
+
+    auto connectClient = []
+    {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        strcpy(address.sun_path, "daemon.sock");
+        return connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0 ? fd : -1;
+    };
+    const std::string json = R"({"a":1})";
+    std::vector<uint8_t> request = { Daemon::ConvertJson, static_cast<uint8_t>(json.size()), 0, 0, 0 };
+    request.insert(request.end(), json.begin(), json.end());
+    auto answered = [](int fd, int timeoutMs)
+    {
+        pollfd poller = { fd, POLLIN, 0 };
+        uint8_t status = 0xFF;
+        return poll(&poller, 1, timeoutMs) == 1 && recv(fd, &status, 1, 0) == 1 && status == Daemon::Ok;
+    };
+
+    int first = connectClient();
+    ASSERT_GE(first, 0);
+    ASSERT_EQ(send(first, request.data(), request.size(), 0), static_cast<ssize_t>(request.size()));
+    EXPECT_TRUE(answered(first, 5000));
+
+    int second = connectClient();
+    ASSERT_GE(second, 0);
+    ASSERT_EQ(send(second, request.data(), request.size(), 0), static_cast<ssize_t>(request.size()));
+    EXPECT_FALSE(answered(second, 200));                    // The only worker is busy with the first connection
+    close(first);
+    EXPECT_TRUE(answered(second, 5000));
+
+    close(second);
+    daemon.Stop();
+    server.join();
+}
+
+TEST(TLVConvertTest, ConvertAndDecode)
+{
+    EXPECT_EQ(tlvc_version(), static_cast<uint32_t>(TLVC_VERSION));
+    tlvc_converter* converter = tlvc_create();
+    ASSERT_NE(converter, nullptr);
+
+    const char json[] = R"({"name":"qwe","count":-300,"big":70000,"ok":true})";
+    uint8_t record[64], dict[128];
+    size_t recordSize = 0, dictSize = 0;
+    EXPECT_EQ(tlvc_convert(converter, json, sizeof(json) - 1, record, 4, &recordSize, dict, sizeof(dict), &dictSize),
+              TLVC_BUFFER_TOO_SMALL);
+    EXPECT_GT(recordSize, 4u);
+    ASSERT_EQ(tlvc_convert(converter, json, sizeof(json) - 1, record, sizeof(record), &recordSize, dict, sizeof(dict),
+                           &dictSize), TLVC_OK);
+
+    JsonToTlvConverter reference;
+    ASSERT_TRUE(reference.Convert(json));
+    EXPECT_EQ(std::vector<uint8_t>(record, record + recordSize),
+              std::vector<uint8_t>(reference.Record().Data(), reference.Record().Data() + reference.Record().Size()));
+
+    tlvc_field fields[4];
+    size_t count = 0;
+    ASSERT_EQ(tlvc_decode_record(record, recordSize, fields, 4, &count), TLVC_OK);
+    ASSERT_EQ(count, 4u);                                   // Sorted by key: big, count, name, ok
+    EXPECT_EQ(fields[0].type, TLVC_UNSIGNED);
+    EXPECT_EQ(fields[0].unsigned_integer, 70000u);
+    EXPECT_EQ(fields[0].width, 4);
+    EXPECT_EQ(fields[1].type, TLVC_SIGNED);
+    EXPECT_EQ(fields[1].integer, -300);
+    EXPECT_EQ(std::string(fields[2].string, fields[2].string_size), "qwe");
+    EXPECT_EQ(fields[3].type, TLVC_BOOL);
+    EXPECT_EQ(fields[3].boolean, 1);
+    EXPECT_EQ(tlvc_decode_record(record, recordSize, fields, 2, &count), TLVC_BUFFER_TOO_SMALL);
+    EXPECT_EQ(count, 4u);
+    EXPECT_EQ(tlvc_decode_record(record, recordSize - 1, fields, 4, &count), TLVC_MALFORMED);
+
+    for (tlvc_dict_format format : { TLVC_DICT_TLV, TLVC_DICT_INDEXED })
+    {
+        ASSERT_EQ(tlvc_set_dict_format(converter, format), TLVC_OK);
+        ASSERT_EQ(tlvc_convert(converter, json, sizeof(json) - 1, record, sizeof(record), &recordSize, dict, sizeof(dict),
+                               &dictSize), TLVC_OK);
+        tlvc_key keys[4];
+        ASSERT_EQ(tlvc_decode_dict(dict, dictSize, keys, 4, &count), TLVC_OK);
+        ASSERT_EQ(count, 4u);
+        std::map<std::string, uint8_t> names;
+        for (const tlvc_key& key : keys) {
+            names[std::string(key.name, key.name_size)] = key.id;
+        }
+        EXPECT_EQ(names, (std::map<std::string, uint8_t> { { "big", 1 }, { "count", 2 }, { "name", 3 }, { "ok", 4 } }));
+    }
+
+    const char* known[] = { "ok" };
+    size_t knownSizes[] = { 2 };
+    ASSERT_EQ(tlvc_set_keys(converter, known, knownSizes, 1), TLVC_OK);
+    ASSERT_EQ(tlvc_convert(converter, json, sizeof(json) - 1, record, sizeof(record), &recordSize, dict, sizeof(dict),
+                           &dictSize), TLVC_OK);
+    ASSERT_EQ(tlvc_decode_record(record, recordSize, fields, 4, &count), TLVC_OK);
+    EXPECT_EQ(fields[3].key, 1);                            // "ok" is known, the rest are numbered after it
+    EXPECT_EQ(fields[0].key, 2);
+
+    EXPECT_EQ(tlvc_convert(converter, "{\"a\":1.5}", 9, record, sizeof(record), &recordSize, dict, sizeof(dict), &dictSize),
+              TLVC_ERROR);
+    EXPECT_STREQ(tlvc_last_error(converter), "floating point value of the key 'a'");
+
+    size_t hugeSizes[] = { SIZE_MAX };                      // The key can't be copied - the exception stays inside
+    EXPECT_EQ(tlvc_set_keys(converter, known, hugeSizes, 1), TLVC_NO_MEMORY);
+    EXPECT_STREQ(tlvc_last_error(converter), "out of memory");
+    EXPECT_EQ(tlvc_convert(converter, json, sizeof(json) - 1, record, sizeof(record), &recordSize, dict, sizeof(dict),
+                           &dictSize), TLVC_OK);
+    tlvc_destroy(converter);
+}
+
+// Check the long keys of the line the general parser takes (duplicate keys - the last one wins) reach the dictionary intact
+TEST(ConverterTest, LongKeysOfGeneralParser)
+{
+    const std::string key = "a_key_longer_than_the_inline_room_of_the_key_map";
+    JsonToTlvConverter converter;
+    ASSERT_TRUE(converter.Convert("{\"" + key + "\":1,\"b\":true,\"" + key + "\":2}"));
+
+    TLVReader reader(converter.Dictionary().Data(), converter.Dictionary().Size());
+    std::string_view name;
+    uint8_t id = 0;
+    EXPECT_TRUE(reader.ReadString(name) && reader.ReadInteger(id));
+    EXPECT_EQ(name, key);
+    EXPECT_EQ(id, 1);
+    EXPECT_TRUE(reader.ReadString(name) && reader.ReadInteger(id));
+    EXPECT_EQ(name, "b");
+    EXPECT_TRUE(reader.AtEnd());
+}
+
+TEST(ConverterTest, BatchMatchesSingleLines)
+{
+    std::vector<std::string_view> lines = { R"({"a":1,"b":"xy"})", R"({"a":1.5})", R"({"c":true,"d":-70000})" };
+    JsonToTlvConverter converter;
+    JsonToTlvConverter::Batch batch;
+    EXPECT_FALSE(converter.ConvertBatch(lines.data(), lines.size(), batch));
+    ASSERT_EQ(batch.Count(), 3u);
+    ASSERT_EQ(batch.errors.size(), 1u);
+    EXPECT_EQ(batch.errors[0].first, 1u);
+    EXPECT_EQ(batch.RecordSize(1) + batch.DictionarySize(1), 0u);
+    EXPECT_EQ(batch.offsets.back(), batch.data.size());
+
+    JsonToTlvConverter single;
+    for (size_t i : { 0, 2 })
+    {
+        ASSERT_TRUE(single.Convert(lines[i]));
+        EXPECT_EQ(std::vector<uint8_t>(batch.Record(i), batch.Record(i) + batch.RecordSize(i)),
+                  std::vector<uint8_t>(single.Record().Data(), single.Record().Data() + single.Record().Size()));
+        EXPECT_EQ(std::vector<uint8_t>(batch.Dictionary(i), batch.Dictionary(i) + batch.DictionarySize(i)),
+                  std::vector<uint8_t>(single.DictionaryData(), single.DictionaryData() + single.DictionarySize()));
+    }
+
+    // The same through the C ABI
+    tlvc_converter* c = tlvc_create();
+    const char* cLines[] = { lines[0].data(), lines[2].data() };
+    size_t cSizes[] = { lines[0].length(), lines[2].length() };
+    size_t offsets[5], size = 0;
+    EXPECT_EQ(tlvc_convert_batch(c, cLines, cSizes, 2, nullptr, 0, &size, offsets), TLVC_BUFFER_TOO_SMALL);
+    std::vector<uint8_t> out(size);
+    ASSERT_EQ(tlvc_convert_batch(c, cLines, cSizes, 2, out.data(), out.size(), &size, offsets), TLVC_OK);
+    EXPECT_EQ(offsets[4], size);
+    EXPECT_EQ(std::vector<uint8_t>(out.begin() + offsets[2], out.begin() + offsets[3]),
+              std::vector<uint8_t>(batch.Record(2), batch.Record(2) + batch.RecordSize(2)));
+    tlvc_destroy(c);
+}